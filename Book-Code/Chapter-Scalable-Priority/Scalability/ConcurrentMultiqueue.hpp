@@ -23,9 +23,11 @@ THE SOFTWARE.
 #ifndef _CONCURRENTMULTIQUEUE_HPP_
 #define _CONCURRENTMULTIQUEUE_HPP_
 
-#include <algorithm>
+#include <array>
+#include <cstdint>
 #include <mutex>
-#include <set>
+#include <utility>
+#include <vector>
 
 // ------------------------------------------------------------------
 //
@@ -34,11 +36,23 @@ THE SOFTWARE.
 // priority item to be dequeued, or by selecting a priority and dequeuing
 // items of the specified priority in the order they were enqueued.
 //
+// Each priority level has a FIFO of its own, kept in a ring buffer that
+// only allocates when it has to grow, and a mask records which levels have
+// items in them.  Every operation is a constant amount of work for a fixed
+// number of levels.  L is a functor that returns the level of an item or a
+// priority, with level 0 being the highest priority.
+//
 // ------------------------------------------------------------------
-template <typename T, typename P, typename C>
+template <typename T, typename P, typename L, std::size_t LEVELS>
 class ConcurrentMultiqueue
 {
 public:
+	ConcurrentMultiqueue() :
+		m_nonEmpty(0)
+	{
+		static_assert(LEVELS <= 32, "The non-empty mask only has room for 32 levels");
+	}
+
 	// ------------------------------------------------------------------
 	//
 	// @details Enqueues a new item onto the queue
@@ -46,46 +60,64 @@ public:
 	// ------------------------------------------------------------------
 	void enqueue(const T& item)
 	{
+		auto level = L()(item);
+
 		std::lock_guard<std::mutex> lock(m_mutex);
 
-		m_queue.insert(item);
+		m_levels[level].push(item);
+		m_nonEmpty |= 1u << level;
 	}
 
 	// ------------------------------------------------------------------
 	//
 	// @details Attempts to dequeue an item from the queue based upon the
-	// specified priority.  If there is an item of that priority available
-	// it is returned by reference.  True is returned if successful, false otherwise.
+	// specified priority.  The oldest item of the highest priority at or
+	// below the specified one is returned by reference.  True is returned
+	// if successful, false otherwise.
 	//
 	// ------------------------------------------------------------------
 	bool dequeue(P priority, T& item)
 	{
 		std::lock_guard<std::mutex> lock(m_mutex);
 
-		bool success = false;
+		return take(L()(priority), item);
+	}
 
-		//
-		// 'item' ends up not actually being used, but the algorithm requires some value is passed in
-		auto itr = std::lower_bound(m_queue.begin(), m_queue.end(), item,
-			[priority](const T& value1, const T& value2)
-			{
-				//
-				// We are saying we know something about the types involved with this
-				// queue...so sue me!
-				return value1->getPriority() < priority;
-			});
+	// ------------------------------------------------------------------
+	//
+	// @details Attempts to dequeue the oldest item of exactly the specified
+	// priority.  True is returned if successful, false otherwise.
+	//
+	// ------------------------------------------------------------------
+	bool dequeueExact(P priority, T& item)
+	{
+		return dequeueIf(priority, item, [](const T&) { return true; });
+	}
 
-		if (itr != m_queue.end())
-		{
-			item = *itr;
-			m_queue.erase(itr);
+	// ------------------------------------------------------------------
+	//
+	// @details Dequeues the oldest item of exactly the specified priority,
+	// but only if the condition holds for it.  True is returned if an item
+	// was dequeued, false otherwise.
+	//
+	// ------------------------------------------------------------------
+	template <typename F>
+	bool dequeueIf(P priority, T& item, F condition)
+	{
+		auto level = L()(priority);
+
+		std::lock_guard<std::mutex> lock(m_mutex);
 
-			success = true;
+		auto& fifo = m_levels[level];
+		if (fifo.empty() || !condition(fifo.front()))
+		{
+			return false;
 		}
+		pop(level, item);
 
-		return success;
+		return true;
 	}
-	
+
 	// ------------------------------------------------------------------
 	//
 	// @details Attempts to dequeue the highest priority item.  If something
@@ -97,23 +129,105 @@ public:
 	{
 		std::lock_guard<std::mutex> lock(m_mutex);
 
-		bool success = false;
+		return take(0, item);
+	}
 
-		auto itr = m_queue.begin();
-		if (itr != m_queue.end())
+private:
+	// ------------------------------------------------------------------
+	//
+	// @details A FIFO kept in a ring buffer.  The capacity is always a
+	// power of two, doubling whenever it fills up.
+	//
+	// ------------------------------------------------------------------
+	class Ring
+	{
+	public:
+		Ring() :
+			m_head(0),
+			m_count(0)
 		{
-			item = *itr;
-			m_queue.erase(itr);
+		}
+
+		bool empty() const		{ return m_count == 0; }
+		const T& front() const	{ return m_items[m_head]; }
 
-			success = true;
+		void push(const T& item)
+		{
+			if (m_count == m_items.size())
+			{
+				grow();
+			}
+			m_items[(m_head + m_count) & (m_items.size() - 1)] = item;
+			m_count++;
 		}
 
-		return success;
-	}
+		void pop(T& item)
+		{
+			//
+			// Moving the item out leaves nothing behind in the slot, so a
+			// shared_ptr isn't kept alive by the buffer.
+			item = std::move(m_items[m_head]);
+			m_items[m_head] = T();
+			m_head = (m_head + 1) & (m_items.size() - 1);
+			m_count--;
+		}
 
-private:
-	std::multiset<T, C> m_queue;	// Using an ordered set to ensure items are removed in the order they were inserted
+	private:
+		std::vector<T> m_items;
+		std::size_t m_head;
+		std::size_t m_count;
+
+		void grow()
+		{
+			std::vector<T> items(m_items.empty() ? 16 : m_items.size() * 2);
+			for (std::size_t position = 0; position < m_count; position++)
+			{
+				items[position] = std::move(m_items[(m_head + position) & (m_items.size() - 1)]);
+			}
+			m_items.swap(items);
+			m_head = 0;
+		}
+	};
+
+	std::array<Ring, LEVELS> m_levels;
+	uint32_t m_nonEmpty;	// Bit for each level that has items
 	std::mutex m_mutex;
+
+	// ------------------------------------------------------------------
+	//
+	// @details Takes the oldest item from the highest priority non-empty
+	// level, starting at the given level.  The mutex must be held.
+	//
+	// ------------------------------------------------------------------
+	bool take(std::size_t first, T& item)
+	{
+		auto candidates = m_nonEmpty & ~((1u << first) - 1);
+		for (auto level = first; candidates != 0; level++)
+		{
+			if ((candidates & (1u << level)) != 0)
+			{
+				pop(level, item);
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	// ------------------------------------------------------------------
+	//
+	// @details Takes the oldest item from a level known to have one, and
+	// keeps the mask up to date.  The mutex must be held.
+	//
+	// ------------------------------------------------------------------
+	void pop(std::size_t level, T& item)
+	{
+		m_levels[level].pop(item);
+		if (m_levels[level].empty())
+		{
+			m_nonEmpty &= ~(1u << level);
+		}
+	}
 };
 
 #endif // _CONCURRENTMULTIQUEUE_HPP_
@@ -0,0 +1,170 @@
+/*
+Copyright (c) 2015 James Dean Mathias
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "ConcurrentMultiqueue.hpp"
+#include "Task.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	const auto THREAD_COUNT = 16;
+	const auto OPERATIONS = 50000;		// Enqueue and dequeue pairs per thread
+
+	class NopTask : public Task
+	{
+	public:
+		NopTask(Priority priority) :
+			Task(nullptr, priority)
+		{
+		}
+
+		virtual void execute() override {}
+	};
+
+	struct PriorityCompare
+	{
+		bool operator()(const std::shared_ptr<Task>& lhs, const std::shared_ptr<Task>& rhs) const
+		{
+			return lhs->getPriority() < rhs->getPriority();
+		}
+	};
+
+	// ------------------------------------------------------------------
+	//
+	// @details The queue ConcurrentMultiqueue used to be, a single multiset
+	// ordered by priority.  Finding the first item of a priority walks the
+	// set from the front, because std::lower_bound can only step through
+	// the set one item at a time.
+	//
+	// ------------------------------------------------------------------
+	class MultisetQueue
+	{
+	public:
+		void enqueue(const std::shared_ptr<Task>& item)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+
+			m_queue.insert(item);
+		}
+
+		bool dequeue(Task::Priority priority, std::shared_ptr<Task>& item)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+
+			auto itr = std::lower_bound(m_queue.begin(), m_queue.end(), item,
+				[priority](const std::shared_ptr<Task>& value1, const std::shared_ptr<Task>&)
+				{
+					return value1->getPriority() < priority;
+				});
+			if (itr == m_queue.end())
+			{
+				return false;
+			}
+			item = *itr;
+			m_queue.erase(itr);
+
+			return true;
+		}
+
+	private:
+		std::multiset<std::shared_ptr<Task>, PriorityCompare> m_queue;
+		std::mutex m_mutex;
+	};
+
+	// ------------------------------------------------------------------
+	//
+	// @details Fills the queue with a backlog of tasks, then has every
+	// thread enqueue a task and dequeue one of a priority, over and over,
+	// the way the worker threads use the queue.  Returns ns per operation.
+	//
+	// ------------------------------------------------------------------
+	template <typename Q>
+	double runQueue(int backlog)
+	{
+		Q queue;
+		std::vector<std::shared_ptr<Task>> tasks;
+		for (auto priority : { Task::Priority::One, Task::Priority::Two, Task::Priority::Three })
+		{
+			tasks.push_back(std::make_shared<NopTask>(priority));
+		}
+		for (auto task = 0; task < backlog; task++)
+		{
+			queue.enqueue(tasks[task % tasks.size()]);
+		}
+
+		std::atomic<bool> go(false);
+		std::vector<std::thread> threads;
+		for (auto thread = 0; thread < THREAD_COUNT; thread++)
+		{
+			threads.emplace_back(
+				[&queue, &tasks, &go, thread]()
+				{
+					while (!go)
+						;
+					std::shared_ptr<Task> item;
+					for (auto operation = 0; operation < OPERATIONS; operation++)
+					{
+						auto& task = tasks[(operation + thread) % tasks.size()];
+						queue.enqueue(task);
+						queue.dequeue(task->getPriority(), item);
+					}
+				});
+		}
+
+		auto timeStart = std::chrono::high_resolution_clock::now();
+		go = true;
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
+		auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::high_resolution_clock::now() - timeStart).count();
+
+		return elapsed / (THREAD_COUNT * OPERATIONS * 2);
+	}
+}
+
+// ------------------------------------------------------------------
+//
+// @details Compares ConcurrentMultiqueue with the multiset it replaced,
+// with a growing backlog of tasks waiting in the queue.
+//
+// ------------------------------------------------------------------
+int main()
+{
+	for (auto backlog : { 0, 1000, 10000 })
+	{
+		std::cout << "backlog of " << backlog << ": " <<
+			"multiset " << runQueue<MultisetQueue>(backlog) << " ns/op, " <<
+			"multiqueue " << runQueue<ConcurrentMultiqueue<std::shared_ptr<Task>, Task::Priority, TaskLevel, TaskLevel::LEVELS>>(backlog) << " ns/op" << std::endl;
+	}
+
+	return 0;
+}
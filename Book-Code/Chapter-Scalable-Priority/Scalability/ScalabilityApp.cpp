@@ -58,14 +58,37 @@ void ScalabilityApp::pulse()
 	m_mandelbrot->update();
 
 	//
-	// Render the most recently computed prime number
+	// Render the most recently computed prime number, along with how long
+	// tasks have been waiting in the thread pool
 	if (m_reportPrime)
 	{
 		std::cout << "Next Prime: " << m_lastPrime << std::endl;
+		reportWaitStats();
 		m_reportPrime = false;
 	}
 }
 
+// ------------------------------------------------------------------
+//
+// @details Reports the time tasks of each priority have spent waiting
+// in the task queue before being started, and how many were started
+// ahead of their priority because they waited too long.
+//
+// ------------------------------------------------------------------
+void ScalabilityApp::reportWaitStats()
+{
+	for (auto priority : { Task::Priority::One, Task::Priority::Two, Task::Priority::Three })
+	{
+		const auto& stats = ThreadPool::instance()->getWaitStats(priority);
+		auto started = stats.started.load();
+		std::cout << "    Priority " << static_cast<int>(priority) << ": " <<
+			started << " started, " <<
+			(started > 0 ? stats.waitTime.load() / started : 0) << " us average wait, " <<
+			stats.maxWait.load() << " us longest, " <<
+			stats.aged.load() << " aged" << std::endl;
+	}
+}
+
 // ------------------------------------------------------------------
 //
 // @details Based upon the currently known largest prime number,
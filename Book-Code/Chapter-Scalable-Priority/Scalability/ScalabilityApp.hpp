@@ -59,6 +59,7 @@ private:
 	uint32_t m_lastPrime;
 
 	void startNextPrime();
+	void reportWaitStats();
 };
 
 #endif // _SCALABILITYAPP_HPP_
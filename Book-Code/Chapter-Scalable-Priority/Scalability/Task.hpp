@@ -23,6 +23,8 @@ THE SOFTWARE.
 #ifndef _TASK_HPP_
 #define _TASK_HPP_
 
+#include <chrono>
+#include <cstddef>
 #include <functional>
 #include <memory>
 
@@ -54,22 +56,34 @@ public:
 
 	Priority getPriority() const		{ return m_priority; }
 
+	void setTimeQueued(std::chrono::high_resolution_clock::time_point timeQueued)	{ m_timeQueued = timeQueued; }
+	std::chrono::high_resolution_clock::time_point getTimeQueued() const			{ return m_timeQueued; }
+
 private:
 	Priority m_priority;
 	std::function<void ()> m_onComplete;
+	std::chrono::high_resolution_clock::time_point m_timeQueued;
 };
 
 // ------------------------------------------------------------------
 //
-// @details This class is used to compare tasks for priority
+// @details This class is used to find the priority level of a task, or
+// of a priority, with zero being the highest priority.
 //
 // ------------------------------------------------------------------
-class TaskCompare : public std::binary_function<const std::shared_ptr<const Task>&, const std::shared_ptr<const Task>&, bool>
+class TaskLevel
 {
 public:
-	bool operator()(const std::shared_ptr<const Task>& lhs, const std::shared_ptr<const Task>& rhs) const
+	static const std::size_t LEVELS = 3;
+
+	std::size_t operator()(Task::Priority priority) const
+	{
+		return static_cast<std::size_t>(priority) - static_cast<std::size_t>(Task::Priority::One);
+	}
+
+	std::size_t operator()(const std::shared_ptr<const Task>& task) const
 	{
-		return (lhs->getPriority() < rhs->getPriority());
+		return (*this)(task->getPriority());
 	}
 };
 
@@ -25,6 +25,8 @@ THE SOFTWARE.
 #include "IRange.hpp"
 
 std::shared_ptr<ThreadPool> ThreadPool::m_instance = nullptr;
+std::array<uint16_t, 3> ThreadPool::m_configReserved = { { 0, 0, 1 } };
+std::chrono::milliseconds ThreadPool::m_configAgingStep(250);
 
 // ------------------------------------------------------------------
 //
@@ -43,6 +45,30 @@ std::shared_ptr<ThreadPool> ThreadPool::instance()
 	return m_instance;
 }
 
+// ------------------------------------------------------------------
+//
+// @details Sets the number of workers reserved for a priority, these are
+// in addition to the Priority::One workers the pool always has.  By default
+// a single Priority::Three worker is reserved.  Must be called before the
+// first call to .instance.
+//
+// ------------------------------------------------------------------
+void ThreadPool::configure(Task::Priority priority, uint16_t reserved)
+{
+	m_configReserved[static_cast<int>(priority) - 1] = reserved;
+}
+
+// ------------------------------------------------------------------
+//
+// @details Sets how long a task waits before it is treated as one priority
+// higher.  Must be called before the first call to .instance.
+//
+// ------------------------------------------------------------------
+void ThreadPool::configure(std::chrono::milliseconds agingStep)
+{
+	m_configAgingStep = agingStep;
+}
+
 // ------------------------------------------------------------------
 //
 // @details The constructor creates the worker threads the thread pool
@@ -55,16 +81,24 @@ ThreadPool::ThreadPool(uint16_t sizeInitial)
 	// We add a few extra threads to allow for some of them to be sitting around on other threads
 	// to complete operations.  We could dynamically adjust this at runtime, up or down, by looking
 	// at the amount of time spent waiting in the queue, but that is for the 2nd edition of the book!
-	for (auto thread : IRange<uint16_t>(1, sizeInitial + 4))
+	for (auto thread : IRange<uint16_t>(1, sizeInitial + 4 + m_configReserved[0]))
 	{
-		auto worker = std::make_shared<WorkerThread>(Task::Priority::One, m_taskQueue, m_eventPriorityOne);
+		auto worker = std::make_shared<WorkerThread>(Task::Priority::One, m_taskQueue, m_eventPriorityOne, m_waitStats, m_configAgingStep);
 		m_threads.insert(worker);
 	}
 
 	//
-	// Make a Priority::Three thread
-	auto worker = std::make_shared<WorkerThread>(Task::Priority::Three, m_taskQueue, m_eventPriorityThree);
-	m_threads.insert(worker);
+	// Make the reserved Priority::Two and Priority::Three threads
+	for (auto thread : IRange<uint16_t>(1, m_configReserved[1]))
+	{
+		auto worker = std::make_shared<WorkerThread>(Task::Priority::Two, m_taskQueue, m_eventPriorityTwo, m_waitStats, m_configAgingStep);
+		m_threads.insert(worker);
+	}
+	for (auto thread : IRange<uint16_t>(1, m_configReserved[2]))
+	{
+		auto worker = std::make_shared<WorkerThread>(Task::Priority::Three, m_taskQueue, m_eventPriorityThree, m_waitStats, m_configAgingStep);
+		m_threads.insert(worker);
+	}
 }
 
 // ------------------------------------------------------------------
@@ -75,6 +109,7 @@ ThreadPool::ThreadPool(uint16_t sizeInitial)
 // ------------------------------------------------------------------
 void ThreadPool::enqueueTask(std::shared_ptr<Task> task)
 {
+	task->setTimeQueued(std::chrono::high_resolution_clock::now());
 	m_taskQueue.enqueue(task);
 	//
 	// Notify threads that match this tasks's priority
@@ -27,6 +27,8 @@ THE SOFTWARE.
 #include "Task.hpp"
 #include "WorkerThread.hpp"
 
+#include <array>
+#include <chrono>
 #include <condition_variable>
 #include <memory>
 #include <set>
@@ -38,27 +40,40 @@ THE SOFTWARE.
 // be used to create & manage worker threads that handle all tasks throughout
 // the system.
 //
+// Each worker starts looking for work at one priority, only moving on to
+// lower priorities when there is nothing left at its own.  Some workers can
+// be reserved for Priority::Two and Priority::Three, so those tasks always
+// have threads looking at them first.  On top of that, tasks that have
+// waited longer than the aging step are taken ahead of higher priority
+// tasks, see WorkerThread.
+//
 // ------------------------------------------------------------------
 class ThreadPool
 {
 public:
 	static std::shared_ptr<ThreadPool> instance();
+	static void configure(Task::Priority priority, uint16_t reserved);
+	static void configure(std::chrono::milliseconds agingStep);
 	static void terminate();
 
 	void enqueueTask(std::shared_ptr<Task> task);
+	const WaitStats& getWaitStats(Task::Priority priority)	{ return m_waitStats[static_cast<int>(priority) - 1]; }
 
 protected:
 	ThreadPool(uint16_t sizeInitial);
 
 private:
 	static std::shared_ptr<ThreadPool> m_instance;
+	static std::array<uint16_t, 3> m_configReserved;	// Extra workers for each priority, Priority::One first
+	static std::chrono::milliseconds m_configAgingStep;
 
 	std::set<std::shared_ptr<WorkerThread>> m_threads;
 
-	ConcurrentMultiqueue<std::shared_ptr<Task>, Task::Priority, TaskCompare> m_taskQueue;
+	ConcurrentMultiqueue<std::shared_ptr<Task>, Task::Priority, TaskLevel, TaskLevel::LEVELS> m_taskQueue;
 	std::condition_variable m_eventPriorityOne;
 	std::condition_variable m_eventPriorityTwo;
 	std::condition_variable m_eventPriorityThree;
+	PriorityWaitStats m_waitStats;
 };
 
 #endif // _THREADPOOL_HPP_
@@ -22,21 +22,25 @@ THE SOFTWARE.
 
 #include "WorkerThread.hpp"
 
+#include <algorithm>
+
 std::mutex WorkerThread::m_mutexEventTaskQueue;
 
 // ------------------------------------------------------------------
 //
 // @details This constructor gets the underlying thread created
 // along with saving references to the task queue, task queue event,
-// and the number of available threads counter.
+// and the wait stats shared by all workers.
 //
 // ------------------------------------------------------------------
-WorkerThread::WorkerThread(Task::Priority priority, ConcurrentMultiqueue<std::shared_ptr<Task>, Task::Priority, TaskCompare>& taskQueue, std::condition_variable& taskQueueEvent) :
+WorkerThread::WorkerThread(Task::Priority priority, ConcurrentMultiqueue<std::shared_ptr<Task>, Task::Priority, TaskLevel, TaskLevel::LEVELS>& taskQueue, std::condition_variable& taskQueueEvent, PriorityWaitStats& waitStats, std::chrono::milliseconds agingStep) :
+	m_thread(nullptr),
+	m_done(false),
 	m_priority(priority),
 	m_taskQueue(taskQueue),
 	m_eventTaskQueue(taskQueueEvent),
-	m_done(false),
-	m_thread(nullptr)
+	m_waitStats(waitStats),
+	m_agingStep(agingStep)
 {
 	m_thread = std::unique_ptr<std::thread>(new std::thread(&WorkerThread::run, this));
 }
@@ -46,7 +50,8 @@ WorkerThread::WorkerThread(Task::Priority priority, ConcurrentMultiqueue<std::sh
 // @details This is the entry point method for the actual worker thread.  This
 // method stays running until we are asked to voluntarily terminate.  The
 // thread waits on a signal to check for something in the task queue.  If there
-// is something in the queue, it goes to work.
+// is something in the queue, it goes to work.  Aged tasks of a lower
+// priority go ahead of those at the current priority.
 //
 // ------------------------------------------------------------------
 void WorkerThread::run()
@@ -59,7 +64,13 @@ void WorkerThread::run()
 		{
 			bool executed = false;
 			std::shared_ptr<Task> task;
-			if (m_taskQueue.dequeue(currentPriority, task))
+			bool found = dequeueAged(currentPriority, task);
+			if (!found && m_taskQueue.dequeue(currentPriority, task))
+			{
+				recordWait(task, false);
+				found = true;
+			}
+			if (found)
 			{
 				task->execute();
 				task->complete();
@@ -97,6 +108,58 @@ void WorkerThread::join()
 	m_thread->join();
 }
 
+// ------------------------------------------------------------------
+//
+// @details Looks for a task of lower priority than the current one that
+// has waited long enough to have aged up to the current priority.  The
+// lowest priority is looked at first, as its tasks have had the longest
+// to wait.  Only the oldest task of each priority needs to be looked at,
+// tasks of the same priority leave the queue in the order they entered.
+//
+// ------------------------------------------------------------------
+bool WorkerThread::dequeueAged(Task::Priority currentPriority, std::shared_ptr<Task>& task)
+{
+	auto now = std::chrono::high_resolution_clock::now();
+	for (auto priority = static_cast<int>(Task::Priority::Three); priority > static_cast<int>(currentPriority); priority--)
+	{
+		auto levels = priority - static_cast<int>(currentPriority);
+		auto aged = [this, now, levels](const std::shared_ptr<Task>& waiting)
+			{
+				return now - waiting->getTimeQueued() >= m_agingStep * levels;
+			};
+		if (m_taskQueue.dequeueIf(static_cast<Task::Priority>(priority), task, aged))
+		{
+			recordWait(task, true);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// ------------------------------------------------------------------
+//
+// @details Adds the time the task spent waiting in the queue to the
+// stats for its priority.
+//
+// ------------------------------------------------------------------
+void WorkerThread::recordWait(const std::shared_ptr<Task>& task, bool aged)
+{
+	auto wait = static_cast<uint64_t>(std::max(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - task->getTimeQueued()).count(), static_cast<std::chrono::microseconds::rep>(0)));
+
+	auto& stats = m_waitStats[static_cast<int>(task->getPriority()) - 1];
+	stats.started++;
+	stats.waitTime += wait;
+	if (aged)
+	{
+		stats.aged++;
+	}
+	auto maxWait = stats.maxWait.load();
+	while (wait > maxWait && !stats.maxWait.compare_exchange_weak(maxWait, wait))
+	{
+	}
+}
+
 // ------------------------------------------------------------------
 //
 // @details This method updates the priority of the tasks the thread
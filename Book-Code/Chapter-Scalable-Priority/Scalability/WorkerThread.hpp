@@ -26,12 +26,40 @@ THE SOFTWARE.
 #include "ConcurrentMultiqueue.hpp"
 #include "Task.hpp"
 
+#include <array>
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <memory>
 #include <mutex>
 #include <thread>
 
+// ------------------------------------------------------------------
+//
+// @details Running totals of how long tasks of one priority waited in
+// the task queue before being started.  Times are in microseconds.
+//
+// ------------------------------------------------------------------
+struct WaitStats
+{
+	WaitStats() :
+		started(0),
+		waitTime(0),
+		maxWait(0),
+		aged(0)
+	{
+	}
+
+	std::atomic<uint64_t> started;
+	std::atomic<uint64_t> waitTime;
+	std::atomic<uint64_t> maxWait;
+	std::atomic<uint64_t> aged;		// Started ahead of their priority because they waited too long
+};
+
+//
+// One set of wait stats for each priority, Priority::One first
+using PriorityWaitStats = std::array<WaitStats, 3>;
+
 // ------------------------------------------------------------------
 //
 // @details This class provides the implementation for worker threads
@@ -39,11 +67,18 @@ THE SOFTWARE.
 // how to effeciently wait on a task queue, then, as tasks become
 // available, it grabs the next one and works on it.
 //
+// A task that has waited a while is aged: for each aging step it has
+// waited, it is treated as one priority higher.  Before taking a task of
+// its current priority, a worker first takes any lower priority task that
+// has aged up to that priority, so lower priority work never waits for
+// more than a bounded time, no matter how much higher priority work
+// keeps arriving.
+//
 // ------------------------------------------------------------------
 class WorkerThread
 {
 public:
-	WorkerThread(Task::Priority priority, ConcurrentMultiqueue<std::shared_ptr<Task>, Task::Priority, TaskCompare>& taskQueue, std::condition_variable& taskQueueEvent);
+	WorkerThread(Task::Priority priority, ConcurrentMultiqueue<std::shared_ptr<Task>, Task::Priority, TaskLevel, TaskLevel::LEVELS>& taskQueue, std::condition_variable& taskQueueEvent, PriorityWaitStats& waitStats, std::chrono::milliseconds agingStep);
 
 	void terminate();
 	void join();
@@ -53,11 +88,15 @@ private:
 	bool m_done;
 
 	Task::Priority m_priority;
-	ConcurrentMultiqueue<std::shared_ptr<Task>, Task::Priority, TaskCompare>& m_taskQueue;
+	ConcurrentMultiqueue<std::shared_ptr<Task>, Task::Priority, TaskLevel, TaskLevel::LEVELS>& m_taskQueue;
 	std::condition_variable& m_eventTaskQueue;
 	static std::mutex m_mutexEventTaskQueue;	// Mutex must be shared between all threads
+	PriorityWaitStats& m_waitStats;
+	std::chrono::milliseconds m_agingStep;
 
 	void run();
+	bool dequeueAged(Task::Priority currentPriority, std::shared_ptr<Task>& task);
+	void recordWait(const std::shared_ptr<Task>& task, bool aged);
 	bool updatePriority(bool executed, Task::Priority& currentPriority);
 };
 
@@ -0,0 +1,159 @@
+/*
+Copyright (c) 2015 James Dean Mathias
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "Future.hpp"
+
+#include "Task.hpp"
+#include "ThreadPool.hpp"
+
+#include <atomic>
+
+namespace
+{
+	// ------------------------------------------------------------------
+	//
+	// @details The task used to run a continuation in the thread pool
+	//
+	// ------------------------------------------------------------------
+	class ContinuationTask : public Task
+	{
+	public:
+		ContinuationTask(std::function<void ()> continuation) :
+			Task(nullptr),
+			m_continuation(continuation)
+		{
+		}
+
+		virtual void execute() override	{ m_continuation(); }
+
+	private:
+		std::function<void ()> m_continuation;
+	};
+}
+
+// ------------------------------------------------------------------
+//
+// @details Reports whether the work has finished
+//
+// ------------------------------------------------------------------
+bool Future::isReady() const
+{
+	std::lock_guard<std::mutex> lock(m_state->mutex);
+
+	return m_state->ready;
+}
+
+// ------------------------------------------------------------------
+//
+// @details Once this future is ready, the continuation is enqueued into
+// the thread pool as a task of its own.  The returned future is ready
+// once the continuation has finished running.
+//
+// ------------------------------------------------------------------
+Future Future::then(std::function<void ()> continuation) const
+{
+	auto task = std::make_shared<ContinuationTask>(continuation);
+	auto future = task->getFuture();
+
+	onReady(
+		[task]()
+		{
+			ThreadPool::instance()->enqueueTask(task);
+		});
+
+	return future;
+}
+
+// ------------------------------------------------------------------
+//
+// @details The callback is invoked by whichever thread makes the future
+// ready, or right away if it already is.  It must be short and must not
+// block, use .then for anything more.
+//
+// ------------------------------------------------------------------
+void Future::onReady(std::function<void ()> callback) const
+{
+	{
+		std::lock_guard<std::mutex> lock(m_state->mutex);
+		if (!m_state->ready)
+		{
+			m_state->callbacks.push_back(callback);
+			return;
+		}
+	}
+
+	callback();
+}
+
+// ------------------------------------------------------------------
+//
+// @details Returns a future that becomes ready once all of the given
+// futures are ready.  Each one counts down a shared total, the last one
+// to finish marks the combined future as ready.
+//
+// ------------------------------------------------------------------
+Future Future::whenAll(const std::vector<Future>& futures)
+{
+	auto promise = Promise();
+	if (futures.empty())
+	{
+		promise.set();
+		return promise.getFuture();
+	}
+
+	auto remaining = std::make_shared<std::atomic<std::size_t>>(futures.size());
+	for (auto& future : futures)
+	{
+		future.onReady(
+			[promise, remaining]() mutable
+			{
+				if (--(*remaining) == 0)
+				{
+					promise.set();
+				}
+			});
+	}
+
+	return promise.getFuture();
+}
+
+// ------------------------------------------------------------------
+//
+// @details Marks the future as ready and invokes everything that was
+// waiting on it.  The callbacks are run outside of the lock, as they are
+// free to attach further callbacks.
+//
+// ------------------------------------------------------------------
+void Promise::set()
+{
+	std::vector<std::function<void ()>> callbacks;
+	{
+		std::lock_guard<std::mutex> lock(m_state->mutex);
+		m_state->ready = true;
+		callbacks.swap(m_state->callbacks);
+	}
+
+	for (auto& callback : callbacks)
+	{
+		callback();
+	}
+}
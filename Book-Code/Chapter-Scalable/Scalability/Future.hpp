@@ -0,0 +1,85 @@
+/*
+Copyright (c) 2015 James Dean Mathias
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#ifndef _FUTURE_HPP_
+#define _FUTURE_HPP_
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// ------------------------------------------------------------------
+//
+// @details A lightweight future that only reports when some piece of work
+// has finished; results are passed the same way they always have been,
+// through memory the task was given.  Nothing ever blocks on one of these.
+// Instead, work that depends upon it is attached as a continuation with
+// .then, which is enqueued into the thread pool as a new task once the
+// future is ready.
+//
+// ------------------------------------------------------------------
+class Future
+{
+public:
+	bool isReady() const;
+	Future then(std::function<void ()> continuation) const;
+	void onReady(std::function<void ()> callback) const;
+
+	static Future whenAll(const std::vector<Future>& futures);
+
+private:
+	friend class Promise;
+
+	struct State
+	{
+		State() : ready(false) {}
+
+		bool ready;
+		std::vector<std::function<void ()>> callbacks;
+		std::mutex mutex;
+	};
+
+	Future(std::shared_ptr<State> state) : m_state(state) {}
+
+	std::shared_ptr<State> m_state;
+};
+
+// ------------------------------------------------------------------
+//
+// @details The other end of a Future, held by whatever is doing the work
+// and used to mark it as ready.
+//
+// ------------------------------------------------------------------
+class Promise
+{
+public:
+	Promise() : m_state(std::make_shared<Future::State>()) {}
+
+	Future getFuture() const	{ return Future(m_state); }
+	void set();
+
+private:
+	std::shared_ptr<Future::State> m_state;
+};
+
+#endif // _FUTURE_HPP_
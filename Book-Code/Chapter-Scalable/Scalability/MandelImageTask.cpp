@@ -26,6 +26,8 @@ THE SOFTWARE.
 #include "MandelPartTask.hpp"
 #include "ThreadPool.hpp"
 
+#include <vector>
+
 // ------------------------------------------------------------------
 //
 // @details Constructor that takes the Mandelbrot computation parameters
@@ -42,7 +44,6 @@ MandelImageTask::MandelImageTask(double startX, double endX, double startY, doub
 	m_sizeY(sizeY),
 	m_pixels(pixels),
 	m_stride(stride),
-	m_partsFinished(0),
 	m_image(nullptr)
 {
 	//
@@ -61,8 +62,15 @@ void MandelImageTask::execute()
 	// For each row, compute how far to move in each of the y direction
 	double deltaY = (m_endY - m_startY) / m_sizeY;
 
+	//
+	// The colors are needed before the first part can possibly be copied, so
+	// get them ready before any of the parts are started.
+	prepareColors();
+
 	//
 	// Create a bunch of smaller work items that compute individual rows in the image
+	std::vector<Future> parts;
+	parts.reserve(m_sizeY);
 	for (auto row : IRange<decltype(m_sizeY)>(0, m_sizeY - 1))
 	{
 		auto task = std::make_shared<MandelPartTask>(
@@ -70,24 +78,16 @@ void MandelImageTask::execute()
 			m_sizeX, m_maxIterations,
 			m_startY + row * deltaY,
 			m_startX, m_endX,
-			std::bind(&MandelImageTask::completePart, this));
-		ThreadPool::instance()->enqueueTask(task);
+			nullptr);
+		parts.push_back(ThreadPool::instance()->submit(task));
 	}
 
-	prepareColors();
-
 	//
-	// Wait for all of these items to finish computing
-	std::unique_lock<std::mutex> lock(m_mutexImageFinished);
-	m_imageFinished.wait(lock,
-		[this]()
-		{
-			//
-			// Might be a spurious wakeup, make sure we have really received all the parts.
-			return m_partsFinished == m_sizeY;
-		});
-
-	copyToPixels();
+	// Once every part has finished, copying the image into the pixels is
+	// scheduled as a task of its own, and this task is complete once that
+	// is done.  The continuation holds a reference to keep this task alive.
+	auto self = std::static_pointer_cast<MandelImageTask>(shared_from_this());
+	completeWhen(Future::whenAll(parts).then([self]() { self->copyToPixels(); }));
 }
 
 // ------------------------------------------------------------------
@@ -146,18 +146,3 @@ void MandelImageTask::copyToPixels()
 		}
 	}
 }
-
-// ------------------------------------------------------------------
-//
-// @details This is the handler used to allow a sub-task to notify
-// this task that it has finished with its part of the image computation.
-//
-// ------------------------------------------------------------------
-void MandelImageTask::completePart()
-{
-	m_partsFinished++;
-	if (m_partsFinished == m_sizeY)
-	{
-		m_imageFinished.notify_one();
-	}
-}
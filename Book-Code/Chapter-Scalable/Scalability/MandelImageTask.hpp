@@ -26,17 +26,16 @@ THE SOFTWARE.
 #include "Task.hpp"
 
 #include <array>
-#include <atomic>
-#include <condition_variable>
 #include <memory>
-#include <mutex>
 #include <string>
 
 // ------------------------------------------------------------------
 //
 // @details This work item manages the computation of a full mandelbrot image.
 // It breaks down the computation into further work items that each
-// compute a single row of the image.
+// compute a single row of the image.  Once all of the rows are finished,
+// the image is copied into the pixels as a continuation, so this task
+// never holds a worker thread while waiting for them.
 //
 // ------------------------------------------------------------------
 class MandelImageTask : public Task
@@ -54,9 +53,6 @@ private:
 		uint8_t b;
 	};
 	std::array<Color, 768> m_colors;
-	std::atomic<uint16_t> m_partsFinished;
-	std::condition_variable m_imageFinished;
-	std::mutex m_mutexImageFinished;
 
 	double m_startX;
 	double m_endX;
@@ -72,7 +68,6 @@ private:
 
 	void prepareColors();
 	void copyToPixels();
-	void completePart();
 };
 
 #endif // _MANDELIMAGETASK_HPP_
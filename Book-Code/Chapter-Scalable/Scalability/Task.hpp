@@ -23,28 +23,57 @@ THE SOFTWARE.
 #ifndef _TASK_HPP_
 #define _TASK_HPP_
 
+#include "Future.hpp"
+
 #include <functional>
+#include <memory>
 
 // ------------------------------------------------------------------
 //
 // @details This is the base class from which all tasks are derived.
 //
+// A task is normally complete as soon as .execute returns.  A task that
+// hands its work off to other tasks can instead call .completeWhen from
+// .execute, and it is completed once that work is finished, without
+// holding on to a worker thread in the meantime.
+//
 // ------------------------------------------------------------------
-class Task
+class Task : public std::enable_shared_from_this<Task>
 {
 public:
 	Task(std::function<void ()> onComplete) :
-		m_onComplete(onComplete)
+		m_onComplete(onComplete),
+		m_deferred(false)
 	{
 	}
 
 	virtual ~Task()						{}	// Virtual destructor to allow derived class destructors to correctly get called
 
 	virtual void execute() = 0;
-	void complete()						{ if (m_onComplete) { m_onComplete(); } }
+	void complete()						{ if (m_onComplete) { m_onComplete(); } m_finished.set(); }
+
+	Future getFuture()					{ return m_finished.getFuture(); }
+	bool isDeferred()					{ return m_deferred; }
+
+protected:
+	// ------------------------------------------------------------------
+	//
+	// @details Completes this task once the future is ready, rather than
+	// when .execute returns.
+	//
+	// ------------------------------------------------------------------
+	void completeWhen(Future future)
+	{
+		m_deferred = true;
+
+		auto self = shared_from_this();
+		future.onReady([self]() { self->complete(); });
+	}
 
 private:
 	std::function<void ()> m_onComplete;
+	Promise m_finished;
+	bool m_deferred;
 };
 
 #endif // _TASK_HPP_
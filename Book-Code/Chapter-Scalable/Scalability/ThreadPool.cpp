@@ -76,6 +76,20 @@ void ThreadPool::enqueueTask(std::shared_ptr<Task> task)
 	m_eventTaskQueue.notify_one();
 }
 
+// ------------------------------------------------------------------
+//
+// @details Enqueues the task and returns a future that becomes ready
+// once the task has completed.
+//
+// ------------------------------------------------------------------
+Future ThreadPool::submit(std::shared_ptr<Task> task)
+{
+	auto future = task->getFuture();
+	enqueueTask(task);
+
+	return future;
+}
+
 // ------------------------------------------------------------------
 //
 // @details Shuts down all of the thread pool worker threads and removes
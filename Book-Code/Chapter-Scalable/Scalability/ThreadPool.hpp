@@ -23,6 +23,7 @@ THE SOFTWARE.
 #ifndef _THREADPOOL_HPP_
 #define _THREADPOOL_HPP_
 
+#include "Future.hpp"
 #include "WorkerThread.hpp"
 #include "Task.hpp"
 
@@ -44,6 +45,7 @@ public:
 	static std::shared_ptr<ThreadPool> instance();
 
 	void enqueueTask(std::shared_ptr<Task> task);
+	Future submit(std::shared_ptr<Task> task);
 	static void terminate();
 
 protected:
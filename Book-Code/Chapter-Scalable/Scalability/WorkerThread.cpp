@@ -56,7 +56,10 @@ void WorkerThread::run()
 		if (m_taskQueue.dequeue(task))
 		{
 			task->execute();
-			task->complete();
+			if (!task->isDeferred())
+			{
+				task->complete();
+			}
 		}
 		else
 		{
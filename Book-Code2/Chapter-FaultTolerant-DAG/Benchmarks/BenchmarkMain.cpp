@@ -0,0 +1,34 @@
+#include "Benchmarks.hpp"
+
+#include <functional>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+int main(int argc, char* argv[])
+{
+	const std::map<std::string, std::function<void (const std::vector<std::string>&)>> benchmarks =
+	{
+		{ "dag-ready", Benchmarks::dagReady },
+		{ "dag-memory", Benchmarks::dagMemory },
+		{ "deadline-heap", Benchmarks::deadlineHeap },
+		{ "distribution", Benchmarks::distribution },
+		{ "thread-pool", Benchmarks::threadPool }
+	};
+
+	auto benchmark = argc > 1 ? benchmarks.find(argv[1]) : benchmarks.end();
+	if (benchmark == benchmarks.end())
+	{
+		std::cout << "Benchmarks <name> [arguments]" << std::endl;
+		for (const auto& entry : benchmarks)
+		{
+			std::cout << "    " << entry.first << std::endl;
+		}
+		return 1;
+	}
+
+	benchmark->second(std::vector<std::string>(argv + 2, argv + argc));
+
+	return 0;
+}
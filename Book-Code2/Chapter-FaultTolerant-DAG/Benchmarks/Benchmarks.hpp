@@ -0,0 +1,26 @@
+#ifndef _BENCHMARKS_HPP_
+#define _BENCHMARKS_HPP_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// -----------------------------------------------------------------
+//
+// @details Each benchmark is run by name from the command line, with
+// whatever arguments follow the name.  They print their results to
+// standard out.
+//
+// -----------------------------------------------------------------
+namespace Benchmarks
+{
+	void dagReady(const std::vector<std::string>& args);
+	void dagMemory(const std::vector<std::string>& args);
+	void deadlineHeap(const std::vector<std::string>& args);
+	void distribution(const std::vector<std::string>& args);
+	void threadPool(const std::vector<std::string>& args);
+
+	uint64_t getResidentKB();
+}
+
+#endif // _BENCHMARKS_HPP_
@@ -0,0 +1,159 @@
+#include "Benchmarks.hpp"
+
+#include "Shared/Tasks/DAGExampleTask.hpp"
+#include "Shared/Threading/ConcurrentDAG.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Benchmarks
+{
+	namespace
+	{
+		using Clock = std::chrono::high_resolution_clock;
+
+		std::shared_ptr<Tasks::Task> makeTask()
+		{
+			return std::make_shared<Tasks::DAGExampleTask>("");
+		}
+	}
+
+	// -----------------------------------------------------------------
+	//
+	// @details Measures the cost of .dequeue and .finalize as the graph
+	// grows.  The graph is shaped like a Mandelbrot frame, every task feeds
+	// a single finishing task.  Up to 20K tasks are dequeued, as though sent
+	// out to the compute servers, then all of them are finalized.
+	//
+	// -----------------------------------------------------------------
+	void dagReady(const std::vector<std::string>&)
+	{
+		const auto IN_FLIGHT_MOST = std::size_t{ 20000 };
+
+		for (auto size : { std::size_t{ 1000 }, std::size_t{ 10000 }, std::size_t{ 100000 } })
+		{
+			ConcurrentDAG<std::shared_ptr<Tasks::Task>> dag;
+			auto finished = makeTask();
+			for (std::size_t task = 0; task < size; task++)
+			{
+				dag.addEdge(makeTask(), finished);
+			}
+
+			std::vector<std::shared_ptr<Tasks::Task>> inFlight;
+			auto timeStart = Clock::now();
+			while (inFlight.size() < std::min(size, IN_FLIGHT_MOST))
+			{
+				inFlight.push_back(dag.dequeue().get());
+			}
+			for (const auto& task : inFlight)
+			{
+				dag.finalize(task);
+			}
+			auto elapsed = std::chrono::duration<double, std::nano>(Clock::now() - timeStart).count();
+
+			std::cout << "graph of " << size << " tasks: " << elapsed / inFlight.size() << " ns per dequeue and finalize" << std::endl;
+		}
+	}
+
+	// -----------------------------------------------------------------
+	//
+	// @details Reports how much memory the DAG holds on to.  The soak runs
+	// 4M tasks through in 64 task frames, with no more than 128 in flight at
+	// once, the resident size should level off once it has warmed up.  Then
+	// the overhead per node is measured with 1M nodes in the graph at once,
+	// the tasks themselves are created before the measurement starts.
+	//
+	// -----------------------------------------------------------------
+	void dagMemory(const std::vector<std::string>&)
+	{
+		const auto SOAK_TASKS = uint64_t{ 4000000 };
+		const auto FRAME_TASKS = 64;
+		const auto IN_FLIGHT_MOST = std::size_t{ 128 };
+		const auto REPORT_EVERY = uint64_t{ 500000 };
+
+		{
+			ConcurrentDAG<std::shared_ptr<Tasks::Task>> dag;
+			std::deque<std::shared_ptr<Tasks::Task>> inFlight;
+			auto finished = uint64_t{ 0 };
+			auto reportAt = uint64_t{ 0 };
+			while (finished < SOAK_TASKS)
+			{
+				dag.beginGroup();
+				auto frameFinished = makeTask();
+				for (auto task = 0; task < FRAME_TASKS; task++)
+				{
+					dag.addEdge(makeTask(), frameFinished);
+				}
+				dag.endGroup();
+
+				auto task = dag.dequeue();
+				while (task || !inFlight.empty())
+				{
+					if (task)
+					{
+						inFlight.push_back(task.get());
+					}
+					if (!task || inFlight.size() >= IN_FLIGHT_MOST)
+					{
+						dag.finalize(inFlight.front());
+						inFlight.pop_front();
+						finished++;
+					}
+					task = dag.dequeue();
+				}
+
+				if (finished >= reportAt)
+				{
+					std::cout << "soak: " << finished << " tasks, resident " << getResidentKB() << " kB" << std::endl;
+					reportAt += REPORT_EVERY;
+				}
+			}
+		}
+
+		const auto LIVE_NODES = std::size_t{ 1000000 };
+		std::vector<std::shared_ptr<Tasks::Task>> tasks;
+		tasks.reserve(LIVE_NODES + LIVE_NODES / FRAME_TASKS);
+		for (std::size_t task = 0; task < LIVE_NODES + LIVE_NODES / FRAME_TASKS; task++)
+		{
+			tasks.push_back(makeTask());
+		}
+
+		auto before = getResidentKB();
+		ConcurrentDAG<std::shared_ptr<Tasks::Task>> dag;
+		for (std::size_t task = 0; task < LIVE_NODES; task++)
+		{
+			dag.addEdge(tasks[task], tasks[LIVE_NODES + task / FRAME_TASKS]);
+		}
+		std::cout << "graph overhead: " << (getResidentKB() - before) * 1024.0 / tasks.size() << " bytes per node" << std::endl;
+	}
+
+	// -----------------------------------------------------------------
+	//
+	// @details Returns the resident set size of the process, or 0 where it
+	// can't be found out.
+	//
+	// -----------------------------------------------------------------
+	uint64_t getResidentKB()
+	{
+		auto resident = uint64_t{ 0 };
+#ifdef __linux__
+		std::ifstream status("/proc/self/status");
+		std::string line;
+		while (std::getline(status, line))
+		{
+			if (line.compare(0, 6, "VmRSS:") == 0)
+			{
+				resident = std::stoull(line.substr(6));
+			}
+		}
+#endif
+
+		return resident;
+	}
+}
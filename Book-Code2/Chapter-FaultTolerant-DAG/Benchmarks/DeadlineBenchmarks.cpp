@@ -0,0 +1,129 @@
+#include "Benchmarks.hpp"
+
+#include "Shared/Threading/IndexedHeap.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/heap/binomial_heap.hpp>
+
+namespace Benchmarks
+{
+	namespace
+	{
+		using Clock = std::chrono::high_resolution_clock;
+
+		//
+		// The way assigned task deadlines used to be kept, a binomial heap
+		// along with a map from task id to its handle in the heap.
+		class BinomialDeadlines
+		{
+		public:
+			void set(uint64_t id, Clock::time_point deadline)
+			{
+				auto handle = m_handles.find(id);
+				if (handle == m_handles.end())
+				{
+					m_handles[id] = m_heap.push(Entry{ deadline, id });
+				}
+				else
+				{
+					(*handle->second).deadline = deadline;
+					m_heap.update(handle->second);
+				}
+			}
+
+			void erase(uint64_t id)
+			{
+				auto handle = m_handles.find(id);
+				m_heap.erase(handle->second);
+				m_handles.erase(handle);
+			}
+
+		private:
+			struct Entry
+			{
+				Clock::time_point deadline;
+				uint64_t id;
+			};
+			struct EntryCompare
+			{
+				bool operator()(const Entry& lhs, const Entry& rhs) const { return lhs.deadline > rhs.deadline; }
+			};
+			using Heap = boost::heap::binomial_heap<Entry, boost::heap::compare<EntryCompare>>;
+
+			Heap m_heap;
+			std::unordered_map<uint64_t, Heap::handle_type> m_handles;
+		};
+
+		class HeapDeadlines
+		{
+		public:
+			void set(uint64_t id, Clock::time_point deadline)	{ m_heap.set(id, deadline); }
+			void erase(uint64_t id)								{ m_heap.erase(id); }
+
+		private:
+			IndexedHeap<uint64_t, Clock::time_point> m_heap;
+		};
+
+		// -----------------------------------------------------------------
+		//
+		// @details Fills the deadlines with the outstanding tasks, then times
+		// a steady mix of work: three in four operations move the deadline of
+		// a task, as a status coming in does, and the fourth finishes a task
+		// and assigns a new one in its place.  Returns ns per operation.
+		//
+		// -----------------------------------------------------------------
+		template <typename D>
+		double runDeadlines(std::size_t outstanding)
+		{
+			const auto OPERATIONS = std::size_t{ 2000000 };
+
+			D deadlines;
+			std::mt19937_64 random(1);
+			auto now = Clock::now();
+			auto nextDeadline = [&random, now]() { return now + std::chrono::milliseconds(100 + random() % 5000); };
+
+			std::vector<uint64_t> ids(outstanding);
+			for (std::size_t task = 0; task < outstanding; task++)
+			{
+				ids[task] = task + 1;
+				deadlines.set(ids[task], nextDeadline());
+			}
+
+			auto nextId = outstanding + 1;
+			auto timeStart = Clock::now();
+			for (std::size_t operation = 0; operation < OPERATIONS; operation++)
+			{
+				auto& id = ids[random() % outstanding];
+				if (operation % 4 == 3)
+				{
+					deadlines.erase(id);
+					id = nextId++;
+				}
+				deadlines.set(id, nextDeadline());
+			}
+
+			return std::chrono::duration<double, std::nano>(Clock::now() - timeStart).count() / OPERATIONS;
+		}
+	}
+
+	// -----------------------------------------------------------------
+	//
+	// @details Compares the indexed 4-ary heap used for assigned task
+	// deadlines with the binomial heap and handle map it replaced.
+	//
+	// -----------------------------------------------------------------
+	void deadlineHeap(const std::vector<std::string>&)
+	{
+		for (auto outstanding : { std::size_t{ 100000 }, std::size_t{ 1000000 } })
+		{
+			std::cout << outstanding << " outstanding tasks: " <<
+				"binomial heap " << runDeadlines<BinomialDeadlines>(outstanding) << " ns/op, " <<
+				"4-ary heap " << runDeadlines<HeapDeadlines>(outstanding) << " ns/op" << std::endl;
+		}
+	}
+}
@@ -0,0 +1,150 @@
+#include "Benchmarks.hpp"
+
+#include "Shared/FaultTolerantFramework.hpp"
+#include "Shared/IRange.hpp"
+#include "Shared/Messages/MandelFinishedResult.hpp"
+#include "Shared/Messages/MandelResult.hpp"
+#include "Shared/Tasks/MandelFinishedTask.hpp"
+#include "Shared/Tasks/MandelTask.hpp"
+#include "Shared/Threading/GraphBuilder.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+
+namespace Benchmarks
+{
+	namespace
+	{
+		using Clock = std::chrono::high_resolution_clock;
+
+		const uint16_t IMAGE_SIZE_X = 800;
+		const uint16_t IMAGE_SIZE_Y = 640;
+		const uint16_t IMAGE_ROWS = 32;			// Rows in each strip of the image
+		const uint16_t MAX_ITERATIONS = 250;
+
+		const auto CONNECT_WAIT = std::chrono::seconds(10);
+
+		//
+		// Starts a compute server in its own process, pointed at the framework
+		// on this machine.
+		void launchServer(const std::string& program)
+		{
+#ifdef _WIN32
+			auto command = "start \"\" /b \"" + program + "\" 127.0.0.1 12345 1 1";
+#else
+			auto command = "\"" + program + "\" 127.0.0.1 12345 1 1 > /dev/null &";
+#endif
+			if (std::system(command.c_str()) != 0)
+			{
+				std::cout << "Unable to start " << program << std::endl;
+			}
+		}
+
+		//
+		// Builds the same graph as the Mandelbrot client, strips of the image all
+		// feeding a Normal priority finishing task.
+		void enqueueImage()
+		{
+			GraphBuilder<std::shared_ptr<Tasks::Task>> graph;
+			auto taskFinished = std::make_shared<Tasks::MandelFinishedTask>();
+
+			auto deltaX = 3.0 / IMAGE_SIZE_X;
+			auto deltaY = 2.4 / IMAGE_SIZE_Y;
+			for (auto row : IRange<uint16_t>(0, IMAGE_SIZE_Y - 1, IMAGE_ROWS))
+			{
+				auto task = std::make_shared<Tasks::MandelTask>(
+					row, std::min<uint16_t>(row + IMAGE_ROWS - 1, IMAGE_SIZE_Y - 1),
+					IMAGE_SIZE_X, -2.0, -1.2 + row * deltaY,
+					deltaX, deltaY,
+					MAX_ITERATIONS);
+				graph.addEdge(task, taskFinished);
+			}
+
+			TaskRequestQueue::instance()->enqueueGraph(graph);
+		}
+	}
+
+	// -----------------------------------------------------------------
+	//
+	// @details Runs the framework against several compute servers on this
+	// machine and reports how the Mandelbrot strips were spread across them.
+	// Only tasks on the critical path are sent to the fastest server, so the
+	// strips of an image should be shared out rather than all going to one.
+	//
+	// Arguments: <server program> [servers] [images]
+	//
+	// -----------------------------------------------------------------
+	void distribution(const std::vector<std::string>& args)
+	{
+		if (args.empty())
+		{
+			std::cout << "Benchmarks distribution <server program> [servers] [images]" << std::endl;
+			return;
+		}
+		auto serverCount = args.size() > 1 ? static_cast<std::size_t>(std::stoul(args[1])) : std::size_t{ 3 };
+		auto imageCount = args.size() > 2 ? std::stoul(args[2]) : 4ul;
+
+		std::atomic<unsigned long> imagesFinished(0);
+		std::atomic<uint64_t> strips(0);
+
+		TaskRequestQueue::instance()->setRanking(DAGRanking::CriticalPath);
+		FaultTolerantFramework framework;
+		framework.initialize();
+		framework.registerHandler<Messages::MandelResult>(
+			Messages::Type::MandelResult,
+			[&strips](std::shared_ptr<Messages::MandelResult>) { strips++; });
+		framework.registerHandler<Messages::MandelFinishedResult>(
+			Messages::Type::MandelFinishedResult,
+			[&imagesFinished](std::shared_ptr<Messages::MandelFinishedResult>) { imagesFinished++; });
+
+		for (std::size_t server = 0; server < serverCount; server++)
+		{
+			launchServer(args[0]);
+		}
+		auto connectUntil = Clock::now() + CONNECT_WAIT;
+		while (framework.getServers().size() < serverCount && Clock::now() < connectUntil)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+
+		auto timeStart = Clock::now();
+		for (unsigned long image = 0; image < imageCount; image++)
+		{
+			enqueueImage();
+			while (imagesFinished.load() <= image)
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+		}
+		auto elapsed = std::chrono::duration<double, std::milli>(Clock::now() - timeStart).count();
+
+		//
+		// Sorted by id, so the servers are listed in the order they connected
+		std::map<ServerID_t, uint64_t> completed;
+		auto total = uint64_t{ 0 };
+		for (const auto& server : framework.getServers())
+		{
+			completed[server.first] = server.second.completed;
+			total += server.second.completed;
+		}
+		std::cout << imageCount << " images, " << strips.load() << " strips in " << elapsed << " ms" << std::endl;
+		for (const auto& server : completed)
+		{
+			std::cout << "server " << server.first << ": " << server.second << " results (" <<
+				(100.0 * server.second / std::max(total, uint64_t{ 1 })) << "%)" << std::endl;
+		}
+		for (const auto& estimate : TaskRequestQueue::instance()->getDeadlineEstimates())
+		{
+			std::cout << "server " << estimate.serverId << ", " << estimate.taskType << ": timeout " << estimate.timeout * 1000 << " ms " <<
+				"(interval " << estimate.mean * 1000 << " ms +/- " << estimate.deviation * 1000 << " ms, " << estimate.samples << " samples)" << std::endl;
+		}
+
+		framework.terminate();
+	}
+}
@@ -0,0 +1,96 @@
+#include "Benchmarks.hpp"
+
+#include "Shared/Threading/ThreadPool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+namespace Benchmarks
+{
+	namespace
+	{
+		using Clock = std::chrono::high_resolution_clock;
+
+		const auto STRIP_COUNT = 4000;
+		const auto STRIP_TIME = std::chrono::microseconds(200);
+		const auto HIGH_EVERY = 100;		// One High task for this many strips
+
+		std::atomic<int> finished(0);
+		std::atomic<uint64_t> highWait(0);	// Nanoseconds
+		std::atomic<int> highCount(0);
+
+		//
+		// Stands in for a strip of the image, spins for about as long as a
+		// strip takes to compute.
+		class SpinTask : public Tasks::Task
+		{
+		public:
+			SpinTask(Tasks::Priority priority)
+			{
+				setPriority(priority);
+			}
+
+			virtual void execute() override
+			{
+				if (getPriority() == Tasks::Priority::High)
+				{
+					highWait += std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - getTimeQueued()).count();
+					highCount++;
+				}
+				auto until = Clock::now() + STRIP_TIME;
+				while (Clock::now() < until)
+				{
+				}
+				finished++;
+			}
+
+		protected:
+			virtual std::shared_ptr<Messages::Message> getMessage() override { return nullptr; }
+			virtual std::shared_ptr<Messages::Message> completeCustom(boost::asio::io_service&) override { return nullptr; }
+		};
+	}
+
+	// -----------------------------------------------------------------
+	//
+	// @details Runs a stand-in for a Mandelbrot image on the thread pool:
+	// Normal priority strips handed over from outside the pool, the way the
+	// compute server hands over tasks from its io thread, with the odd High
+	// priority task mixed in.  Reports how many tasks were taken by work
+	// stealing, and how long the High ones waited to start.
+	//
+	// -----------------------------------------------------------------
+	void threadPool(const std::vector<std::string>&)
+	{
+		auto cores = static_cast<uint16_t>(std::max(4u, std::thread::hardware_concurrency()));
+		ThreadPool::configure(cores, cores);
+
+		//
+		// Results are posted to the io_service, which is never run, so nothing
+		// is actually sent anywhere.
+		boost::asio::io_service ioService;
+		ThreadPool::instance()->initialize(&ioService);
+
+		auto timeStart = Clock::now();
+		for (auto strip = 0; strip < STRIP_COUNT; strip++)
+		{
+			auto priority = strip % HIGH_EVERY == 0 ? Tasks::Priority::High : Tasks::Priority::Normal;
+			ThreadPool::instance()->enqueueTask(std::make_shared<SpinTask>(priority));
+		}
+		while (finished.load() < STRIP_COUNT)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		auto elapsed = std::chrono::duration<double, std::milli>(Clock::now() - timeStart).count();
+
+		auto stats = ThreadPool::instance()->getStats();
+		std::cout << "workers:            " << cores << std::endl;
+		std::cout << "tasks:              " << stats.started << " in " << elapsed << " ms" << std::endl;
+		std::cout << "taken by stealing:  " << stats.stolen << std::endl;
+		std::cout << "high priority wait: " << (highWait.load() / 1000.0 / std::max(highCount.load(), 1)) << " us average over " << highCount.load() << std::endl;
+
+		ThreadPool::terminate();
+	}
+}
@@ -20,7 +20,7 @@ namespace
 	// ------------------------------------------------------------------
 	void startChapterDemo()
 	{
-		TaskRequestQueue::instance()->beginGroup();
+		GraphBuilder<std::shared_ptr<Tasks::Task>> graph;
 
 		auto task1 = std::make_shared<Tasks::DAGExampleTask>("1");
 		auto task2 = std::make_shared<Tasks::DAGExampleTask>("2");
@@ -53,37 +53,37 @@ namespace
 		auto task28 = std::make_shared<Tasks::DAGExampleTask>("28");
 		auto task29 = std::make_shared<Tasks::DAGExampleTask>("29");
 
-		TaskRequestQueue::instance()->enqueueTask(task2, task1);
-		TaskRequestQueue::instance()->enqueueTask(task3, task1);
-		TaskRequestQueue::instance()->enqueueTask(task4, task2);
-		TaskRequestQueue::instance()->enqueueTask(task5, task2);
-		TaskRequestQueue::instance()->enqueueTask(task6, task3);
-		TaskRequestQueue::instance()->enqueueTask(task7, task3);
-		TaskRequestQueue::instance()->enqueueTask(task8, task4);
-		TaskRequestQueue::instance()->enqueueTask(task9, task4);
-		TaskRequestQueue::instance()->enqueueTask(task10, task5);
-		TaskRequestQueue::instance()->enqueueTask(task11, task5);
-		TaskRequestQueue::instance()->enqueueTask(task12, task6);
-		TaskRequestQueue::instance()->enqueueTask(task13, task6);
-		TaskRequestQueue::instance()->enqueueTask(task14, task7);
-		TaskRequestQueue::instance()->enqueueTask(task15, task7);
-
-		TaskRequestQueue::instance()->enqueueTask(task1, task16);
-		TaskRequestQueue::instance()->enqueueTask(task1, task17);
-		TaskRequestQueue::instance()->enqueueTask(task16, task18);
-		TaskRequestQueue::instance()->enqueueTask(task16, task19);
-		TaskRequestQueue::instance()->enqueueTask(task17, task20);
-		TaskRequestQueue::instance()->enqueueTask(task17, task21);
-		TaskRequestQueue::instance()->enqueueTask(task18, task22);
-		TaskRequestQueue::instance()->enqueueTask(task18, task23);
-		TaskRequestQueue::instance()->enqueueTask(task19, task24);
-		TaskRequestQueue::instance()->enqueueTask(task19, task25);
-		TaskRequestQueue::instance()->enqueueTask(task20, task26);
-		TaskRequestQueue::instance()->enqueueTask(task20, task27);
-		TaskRequestQueue::instance()->enqueueTask(task21, task28);
-		TaskRequestQueue::instance()->enqueueTask(task21, task29);
-
-		TaskRequestQueue::instance()->endGroup();
+		graph.addEdge(task2, task1);
+		graph.addEdge(task3, task1);
+		graph.addEdge(task4, task2);
+		graph.addEdge(task5, task2);
+		graph.addEdge(task6, task3);
+		graph.addEdge(task7, task3);
+		graph.addEdge(task8, task4);
+		graph.addEdge(task9, task4);
+		graph.addEdge(task10, task5);
+		graph.addEdge(task11, task5);
+		graph.addEdge(task12, task6);
+		graph.addEdge(task13, task6);
+		graph.addEdge(task14, task7);
+		graph.addEdge(task15, task7);
+
+		graph.addEdge(task1, task16);
+		graph.addEdge(task1, task17);
+		graph.addEdge(task16, task18);
+		graph.addEdge(task16, task19);
+		graph.addEdge(task17, task20);
+		graph.addEdge(task17, task21);
+		graph.addEdge(task18, task22);
+		graph.addEdge(task18, task23);
+		graph.addEdge(task19, task24);
+		graph.addEdge(task19, task25);
+		graph.addEdge(task20, task26);
+		graph.addEdge(task20, task27);
+		graph.addEdge(task21, task28);
+		graph.addEdge(task21, task29);
+
+		TaskRequestQueue::instance()->enqueueGraph(graph);
 	}
 }
 
@@ -109,6 +109,11 @@ FaultTolerantApp::FaultTolerantApp(HWND hwnd, uint16_t sizeX, uint16_t sizeY) :
 // ------------------------------------------------------------------
 bool FaultTolerantApp::initialize()
 {
+	//
+	// Start the tasks on the longest remaining path through the DAG first, it
+	// shortens how long it takes for the whole DAG to complete.
+	TaskRequestQueue::instance()->setRanking(DAGRanking::CriticalPath);
+
 	m_ftFramework.initialize();
 
 	//
@@ -163,14 +168,33 @@ void FaultTolerantApp::pulse()
 	m_mandelbrot->update();
 
 	//
-	// Render the most recently computed prime number
+	// Render the most recently computed prime number, along with the task
+	// timeouts learned so far
 	if (m_reportPrime)
 	{
 		std::cout << "Next Prime: " << m_lastPrime << std::endl;
+		reportDeadlineEstimates();
 		m_reportPrime = false;
 	}
 }
 
+// ------------------------------------------------------------------
+//
+// @details Reports the timeout currently learned for each compute server
+// and type of task, along with the interval and deviation it comes from.
+//
+// ------------------------------------------------------------------
+void FaultTolerantApp::reportDeadlineEstimates()
+{
+	for (const auto& estimate : TaskRequestQueue::instance()->getDeadlineEstimates())
+	{
+		std::cout << "    Server " << estimate.serverId << ", " << estimate.taskType << ": " <<
+			"timeout " << estimate.timeout * 1000 << " ms, " <<
+			"interval " << estimate.mean * 1000 << " ms +/- " << estimate.deviation * 1000 << " ms, " <<
+			estimate.samples << " samples" << std::endl;
+	}
+}
+
 // ------------------------------------------------------------------
 //
 // @details Places the pixels for this result copied into the displayable image.
@@ -54,6 +54,7 @@ private:
 	void processMandelFinishedResult(std::shared_ptr<Messages::MandelFinishedResult> taskResult);
 	void processNextPrimeResult(std::shared_ptr<Messages::NextPrimeResult> taskResult);
 	void processDAGExampleResult(std::shared_ptr<Messages::DAGExampleResult> taskResult);
+	void reportDeadlineEstimates();
 };
 
 #endif // _FAULTTOLERANTAPP_HPP_
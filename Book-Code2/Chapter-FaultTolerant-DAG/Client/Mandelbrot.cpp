@@ -18,6 +18,8 @@ Mandelbrot::Mandelbrot(HWND hwnd, uint16_t sizeX, uint16_t sizeY) :
 	m_sizeY(sizeY),
 	m_updateRequired(true),
 	m_inUpdate(false),
+	m_imageGroup(0),
+	m_imageFinishedId(0),
 	m_mandelLeft(-2.0),
 	m_mandelRight(1.0),
 	m_mandelTop(-1.5),
@@ -38,8 +40,15 @@ Mandelbrot::Mandelbrot(HWND hwnd, uint16_t sizeX, uint16_t sizeY) :
 // -----------------------------------------------------------------
 void Mandelbrot::update()
 {
-	if (m_updateRequired && !m_inUpdate)
+	if (m_updateRequired)
 	{
+		//
+		// If the view changed before the last image finished, what is left of
+		// that image is no longer wanted.
+		if (m_inUpdate)
+		{
+			TaskRequestQueue::instance()->cancelGroup(m_imageGroup);
+		}
 		m_inUpdate = true;
 		m_updateRequired = false;
 		startNewImage();
@@ -75,7 +84,13 @@ void Mandelbrot::processMandelResult(Messages::MandelResult& taskResult)
 // -----------------------------------------------------------------
 void Mandelbrot::processMandelFinishedResult(Messages::MandelFinishedResult& taskResult)
 {
-	m_inUpdate = false;
+	//
+	// Only the current image counts, an earlier image may have finished just
+	// as it was being cancelled.
+	if (taskResult.getTaskId() == m_imageFinishedId)
+	{
+		m_inUpdate = false;
+	}
 }
 
 // -----------------------------------------------------------------
@@ -86,15 +101,28 @@ void Mandelbrot::processMandelFinishedResult(Messages::MandelFinishedResult& tas
 // -----------------------------------------------------------------
 void Mandelbrot::startNewImage()
 {
-	TaskRequestQueue::instance()->beginGroup();
+	//
+	// The tasks are all put together in a private graph first and then handed to the
+	// framework in one step, this keeps the task distributor from being held up while
+	// the tasks are created.
+	GraphBuilder<std::shared_ptr<Tasks::Task>> graph;
 
 	//
 	// Create the task that is executed when all of the small sub-image tasks
 	// have completed...the framework DAG takes care of this for us automatically!
 	//
-	// NOTE: This task never directly gets added to the queue.  Because it is identified
+	// NOTE: This task never directly gets added to the graph.  Because it is identified
 	// as a dependent task by other tasks, it gets added at that time.
 	auto taskFinished = std::make_shared<Tasks::MandelFinishedTask>();
+	//
+	// All tasks for the image share a group id, so the image can be cancelled as a whole.
+	m_imageGroup++;
+	m_imageFinishedId = taskFinished->getId();
+	taskFinished->setGroupId(m_imageGroup);
+	//
+	// The finishing task is left at Normal priority.  Every part of the image
+	// is upstream of it, so anything more urgent would be inherited by the
+	// whole image, leaving nothing for High to stand out from.
 
 	auto deltaX = (m_mandelRight - m_mandelLeft) / m_sizeX;
 	auto deltaY = (m_mandelBottom - m_mandelTop) / m_sizeY;
@@ -106,10 +134,11 @@ void Mandelbrot::startNewImage()
 			m_sizeX, m_mandelLeft, m_mandelTop + row * deltaY,
 			deltaX, deltaY,
 			MANDLE_MAX_ITERATIONS);
-		TaskRequestQueue::instance()->enqueueTask(task, taskFinished);
+		task->setGroupId(m_imageGroup);
+		graph.addEdge(task, taskFinished);
 	}
 
-	TaskRequestQueue::instance()->endGroup();
+	TaskRequestQueue::instance()->enqueueGraph(graph);
 }
 
 // -----------------------------------------------------------------
@@ -148,13 +177,10 @@ void Mandelbrot::prepareColors()
 // -----------------------------------------------------------------
 void Mandelbrot::moveLeft()
 { 
-	if (!m_inUpdate)
-	{
-		auto distance = (m_mandelRight - m_mandelLeft) * MANDEL_MOVEMENT_RATE;
-		m_mandelLeft -= distance;
-		m_mandelRight -= distance;
-		m_updateRequired = true;
-	}
+	auto distance = (m_mandelRight - m_mandelLeft) * MANDEL_MOVEMENT_RATE;
+	m_mandelLeft -= distance;
+	m_mandelRight -= distance;
+	m_updateRequired = true;
 }
 
 // -----------------------------------------------------------------
@@ -164,13 +190,10 @@ void Mandelbrot::moveLeft()
 // -----------------------------------------------------------------
 void Mandelbrot::moveRight()
 {
-	if (!m_inUpdate)
-	{
-		auto distance = (m_mandelRight - m_mandelLeft) * MANDEL_MOVEMENT_RATE;
-		m_mandelLeft += distance;
-		m_mandelRight += distance;
-		m_updateRequired = true;
-	}
+	auto distance = (m_mandelRight - m_mandelLeft) * MANDEL_MOVEMENT_RATE;
+	m_mandelLeft += distance;
+	m_mandelRight += distance;
+	m_updateRequired = true;
 }
 
 // -----------------------------------------------------------------
@@ -180,13 +203,10 @@ void Mandelbrot::moveRight()
 // -----------------------------------------------------------------
 void Mandelbrot::moveUp()
 {
-	if (!m_inUpdate)
-	{
-		auto distance = (m_mandelBottom - m_mandelTop) * MANDEL_MOVEMENT_RATE;
-		m_mandelTop += distance;
-		m_mandelBottom += distance;
-		m_updateRequired = true;
-	}
+	auto distance = (m_mandelBottom - m_mandelTop) * MANDEL_MOVEMENT_RATE;
+	m_mandelTop += distance;
+	m_mandelBottom += distance;
+	m_updateRequired = true;
 }
 
 // -----------------------------------------------------------------
@@ -196,13 +216,10 @@ void Mandelbrot::moveUp()
 // -----------------------------------------------------------------
 void Mandelbrot::moveDown()
 {
-	if (!m_inUpdate)
-	{
-		auto distance = (m_mandelBottom - m_mandelTop) * MANDEL_MOVEMENT_RATE;
-		m_mandelTop -= distance;
-		m_mandelBottom -= distance;
-		m_updateRequired = true;
-	}
+	auto distance = (m_mandelBottom - m_mandelTop) * MANDEL_MOVEMENT_RATE;
+	m_mandelTop -= distance;
+	m_mandelBottom -= distance;
+	m_updateRequired = true;
 }
 
 // -----------------------------------------------------------------
@@ -212,19 +229,16 @@ void Mandelbrot::moveDown()
 // -----------------------------------------------------------------
 void Mandelbrot::zoomIn()
 {
-	if (!m_inUpdate)
-	{
-		auto distanceX = (m_mandelRight - m_mandelLeft) * MANDEL_MOVEMENT_RATE;
-		auto distanceY = (m_mandelBottom - m_mandelTop) * MANDEL_MOVEMENT_RATE;
+	auto distanceX = (m_mandelRight - m_mandelLeft) * MANDEL_MOVEMENT_RATE;
+	auto distanceY = (m_mandelBottom - m_mandelTop) * MANDEL_MOVEMENT_RATE;
 
-		m_mandelLeft += distanceX;
-		m_mandelRight -= distanceX;
+	m_mandelLeft += distanceX;
+	m_mandelRight -= distanceX;
 
-		m_mandelTop += distanceY;
-		m_mandelBottom -= distanceY;
+	m_mandelTop += distanceY;
+	m_mandelBottom -= distanceY;
 
-		m_updateRequired = true;
-	}
+	m_updateRequired = true;
 }
 
 // -----------------------------------------------------------------
@@ -234,19 +248,16 @@ void Mandelbrot::zoomIn()
 // -----------------------------------------------------------------
 void Mandelbrot::zoomOut()
 {
-	if (!m_inUpdate)
-	{
-		auto distanceX = (m_mandelRight - m_mandelLeft) * MANDEL_MOVEMENT_RATE;
-		auto distanceY = (m_mandelBottom - m_mandelTop) * MANDEL_MOVEMENT_RATE;
+	auto distanceX = (m_mandelRight - m_mandelLeft) * MANDEL_MOVEMENT_RATE;
+	auto distanceY = (m_mandelBottom - m_mandelTop) * MANDEL_MOVEMENT_RATE;
 
-		m_mandelLeft -= distanceX;
-		m_mandelRight += distanceX;
+	m_mandelLeft -= distanceX;
+	m_mandelRight += distanceX;
 
-		m_mandelTop -= distanceY;
-		m_mandelBottom += distanceY;
+	m_mandelTop -= distanceY;
+	m_mandelBottom += distanceY;
 
-		m_updateRequired = true;
-	}
+	m_updateRequired = true;
 }
 
 // -----------------------------------------------------------------
@@ -57,6 +57,8 @@ private:
 
 	std::atomic<bool> m_updateRequired;
 	std::atomic<bool> m_inUpdate;
+	uint64_t m_imageGroup;						// Group id of the tasks for the image being computed
+	std::atomic<uint64_t> m_imageFinishedId;	// Id of the task that completes that image
 
 	//
 	// Extents of the mandelbrot region being shown
@@ -1,18 +1,21 @@
 #include "ComputeServer.hpp"
 
-#include "Shared/IRange.hpp"
+#include "Shared/ResultCache.hpp"
 #include "Shared/TaskStatusTool.hpp"
 #include "Shared/Messages/DAGExample.hpp"
 #include "Shared/Messages/MandelFinished.hpp"
 #include "Shared/Messages/MandelMessage.hpp"
 #include "Shared/Messages/NextPrime.hpp"
+#include "Shared/Messages/TaskBatch.hpp"
 #include "Shared/Messages/TaskRequest.hpp"
+#include "Shared/Messages/TaskStatus.hpp"
 #include "Shared/Tasks/DAGExampleTask.hpp"
 #include "Shared/Tasks/MandelFinishedTask.hpp"
 #include "Shared/Tasks/MandelTask.hpp"
 #include "Shared/Tasks/NextPrimeTask.hpp"
 #include "Shared/Threading/ThreadPool.hpp"
 
+#include <algorithm>
 #include <iostream>
 #include <thread>
 
@@ -20,17 +23,90 @@ namespace
 {
 	// ------------------------------------------------------------------
 	//
-	// @details Finishes reading a task message, then places the task onto 
-	// the thread pool for execution.
+	// @details Finishes reading a dataflow message and holds on to it until
+	// the task it belongs to arrives, which is always the next message for
+	// that task.
+	//
+	// ------------------------------------------------------------------
+	void processDataflow(std::shared_ptr<ip::tcp::socket> socket, std::unordered_map<uint64_t, std::shared_ptr<Messages::TaskDataflow>>& dataflow)
+	{
+		auto message = std::make_shared<Messages::TaskDataflow>();
+		Messages::read(*message, socket);
+		dataflow[message->getTaskId()] = message;
+	}
+
+	// ------------------------------------------------------------------
+	//
+	// @details The same as processDataflow, for a dataflow message that
+	// came as part of a batch.
+	//
+	// ------------------------------------------------------------------
+	void processBatchedDataflow(const std::string& body, std::unordered_map<uint64_t, std::shared_ptr<Messages::TaskDataflow>>& dataflow)
+	{
+		auto message = std::make_shared<Messages::TaskDataflow>();
+		Messages::parse(*message, body);
+		dataflow[message->getTaskId()] = message;
+	}
+
+	// ------------------------------------------------------------------
+	//
+	// @details Fills in the dataflow details of a task, and its priority.
+	// Inputs the client didn't send are taken from the result cache.  Returns
+	// false if any of the inputs couldn't be found, in which case the task
+	// can't be run here.
+	//
+	// ------------------------------------------------------------------
+	bool prepareDataflow(Tasks::Task& task, Messages::TaskDataflow& dataflow)
+	{
+		std::vector<Tasks::Input> inputs;
+		inputs.reserve(dataflow.getInputs().size());
+		for (const auto& input : dataflow.getInputs())
+		{
+			auto payload = input.has_payload() ?
+				std::make_shared<const std::string>(input.payload()) :
+				ResultCache::instance()->get(input.sourceid());
+			if (!payload)
+			{
+				return false;
+			}
+			inputs.push_back(Tasks::Input{ input.sourceid(), payload });
+		}
+
+		task.setRetainResult(dataflow.getRetainResult());
+		task.setInputs(std::move(inputs));
+		task.setPriority(static_cast<Tasks::Priority>(std::min(dataflow.getPriority(), static_cast<uint32_t>(Tasks::Priority::Low))));
+
+		return true;
+	}
+
+	// ------------------------------------------------------------------
+	//
+	// @details Places the task for a message onto the thread pool for
+	// execution.
 	//
 	// ------------------------------------------------------------------
 	template <typename Message, typename Task>
-	void processTask(std::shared_ptr<ip::tcp::socket> socket)
+	void startTask(std::shared_ptr<ip::tcp::socket> socket, Message& message, std::unordered_map<uint64_t, std::shared_ptr<Messages::TaskDataflow>>& dataflow)
 	{
-		auto message = Message{};
-		Messages::read(message, socket);
 		auto task = std::make_shared<Task>(socket, message);
 
+		auto details = dataflow.find(task->getId());
+		if (details != dataflow.end())
+		{
+			auto ready = prepareDataflow(*task, *details->second);
+			dataflow.erase(details);
+			if (!ready)
+			{
+				//
+				// An input has been dropped from the cache.  Let the client know right
+				// away so it can send the task again, this time with all of its inputs,
+				// and ask for another task in place of this one.
+				Messages::send(std::make_shared<Messages::TaskStatus>(task->getId(), PBMessages::TaskStatus_Status_Fault), socket, socket->get_io_service());
+				Tasks::Task::returnCredit(socket, socket->get_io_service());
+				return;
+			}
+		}
+
 		//
 		// Add this to the status reporting tool so the client is able
 		// to track the status of the task.
@@ -39,6 +115,50 @@ namespace
 		ThreadPool::instance()->enqueueTask(task);
 	}
 
+	// ------------------------------------------------------------------
+	//
+	// @details Finishes reading a task message, then places the task onto 
+	// the thread pool for execution.
+	//
+	// ------------------------------------------------------------------
+	template <typename Message, typename Task>
+	void processTask(std::shared_ptr<ip::tcp::socket> socket, std::unordered_map<uint64_t, std::shared_ptr<Messages::TaskDataflow>>& dataflow)
+	{
+		auto message = Message{};
+		Messages::read(message, socket);
+		startTask<Message, Task>(socket, message, dataflow);
+	}
+
+	// ------------------------------------------------------------------
+	//
+	// @details The same as processTask, for a task message that came as
+	// part of a batch.
+	//
+	// ------------------------------------------------------------------
+	template <typename Message, typename Task>
+	void processBatchedTask(std::shared_ptr<ip::tcp::socket> socket, const std::string& body, std::unordered_map<uint64_t, std::shared_ptr<Messages::TaskDataflow>>& dataflow)
+	{
+		auto message = Message{};
+		Messages::parse(message, body);
+		startTask<Message, Task>(socket, message, dataflow);
+	}
+
+	// ------------------------------------------------------------------
+	//
+	// @details The client sends a task status when it no longer wants the
+	// result of a task, the task is cancelled in the thread pool.
+	//
+	// ------------------------------------------------------------------
+	void processTaskStatus(std::shared_ptr<ip::tcp::socket> socket)
+	{
+		auto status = Messages::TaskStatus{};
+		Messages::read(status, socket);
+		if (status.getStatus() == PBMessages::TaskStatus_Status_Cancelled)
+		{
+			ThreadPool::instance()->cancelTask(status.getTaskId());
+		}
+	}
+
 	// ------------------------------------------------------------------
 	//
 	// @details When the terminate command is received, do a somewhat
@@ -83,11 +203,47 @@ void ComputeServer::initialize(boost::asio::io_service* ioService, const std::st
 // -----------------------------------------------------------------
 void ComputeServer::prepareCommandMap()
 {
-	m_messageCommand[Messages::Type::MandelMessage] = [this](std::shared_ptr<ip::tcp::socket> socket) { processTask<Messages::MandelMessage, Tasks::MandelTask>(socket); };
-	m_messageCommand[Messages::Type::MandelFinished] = [this](std::shared_ptr<ip::tcp::socket> socket) { processTask<Messages::MandelFinished, Tasks::MandelFinishedTask>(socket); };
-	m_messageCommand[Messages::Type::NextPrime] = [this](std::shared_ptr<ip::tcp::socket> socket) { processTask<Messages::NextPrime, Tasks::NextPrimeTask>(socket); };
+	m_messageCommand[Messages::Type::TaskBatch] = [this](std::shared_ptr<ip::tcp::socket> socket) { processTaskBatch(socket); };
+	m_messageCommand[Messages::Type::MandelMessage] = [this](std::shared_ptr<ip::tcp::socket> socket) { processTask<Messages::MandelMessage, Tasks::MandelTask>(socket, m_dataflow); };
+	m_messageCommand[Messages::Type::MandelFinished] = [this](std::shared_ptr<ip::tcp::socket> socket) { processTask<Messages::MandelFinished, Tasks::MandelFinishedTask>(socket, m_dataflow); };
+	m_messageCommand[Messages::Type::NextPrime] = [this](std::shared_ptr<ip::tcp::socket> socket) { processTask<Messages::NextPrime, Tasks::NextPrimeTask>(socket, m_dataflow); };
 	m_messageCommand[Messages::Type::TerminateCommand] = [this](std::shared_ptr<ip::tcp::socket> socket) { processTerminateCommand(socket); };
-	m_messageCommand[Messages::Type::DAGExample] = [this](std::shared_ptr<ip::tcp::socket> socket) { processTask<Messages::DAGExample, Tasks::DAGExampleTask>(socket); };
+	m_messageCommand[Messages::Type::DAGExample] = [this](std::shared_ptr<ip::tcp::socket> socket) { processTask<Messages::DAGExample, Tasks::DAGExampleTask>(socket, m_dataflow); };
+	m_messageCommand[Messages::Type::TaskDataflow] = [this](std::shared_ptr<ip::tcp::socket> socket) { processDataflow(socket, m_dataflow); };
+	m_messageCommand[Messages::Type::TaskStatus] = [this](std::shared_ptr<ip::tcp::socket> socket) { processTaskStatus(socket); };
+
+	//
+	// The messages that can come as part of a batch
+	m_batchCommand[Messages::Type::MandelMessage] = [this](std::shared_ptr<ip::tcp::socket> socket, const std::string& body) { processBatchedTask<Messages::MandelMessage, Tasks::MandelTask>(socket, body, m_dataflow); };
+	m_batchCommand[Messages::Type::MandelFinished] = [this](std::shared_ptr<ip::tcp::socket> socket, const std::string& body) { processBatchedTask<Messages::MandelFinished, Tasks::MandelFinishedTask>(socket, body, m_dataflow); };
+	m_batchCommand[Messages::Type::NextPrime] = [this](std::shared_ptr<ip::tcp::socket> socket, const std::string& body) { processBatchedTask<Messages::NextPrime, Tasks::NextPrimeTask>(socket, body, m_dataflow); };
+	m_batchCommand[Messages::Type::DAGExample] = [this](std::shared_ptr<ip::tcp::socket> socket, const std::string& body) { processBatchedTask<Messages::DAGExample, Tasks::DAGExampleTask>(socket, body, m_dataflow); };
+	m_batchCommand[Messages::Type::TaskDataflow] = [this](std::shared_ptr<ip::tcp::socket>, const std::string& body) { processBatchedDataflow(body, m_dataflow); };
+}
+
+// -----------------------------------------------------------------
+//
+// @details Finishes reading a batch and handles each of the messages in
+// it, in order, just as if they had been received one at a time.
+//
+// -----------------------------------------------------------------
+void ComputeServer::processTaskBatch(std::shared_ptr<ip::tcp::socket> socket)
+{
+	auto batch = Messages::TaskBatch{};
+	Messages::read(batch, socket);
+	for (const auto& entry : batch.getEntries())
+	{
+		auto type = static_cast<Messages::Type>(entry.type());
+		auto command = m_batchCommand.find(type);
+		if (command != m_batchCommand.end())
+		{
+			command->second(socket, entry.body());
+		}
+		else
+		{
+			std::cout << "Unknown batched message type: " << static_cast<uint32_t>(type) << std::endl;
+		}
+	}
 }
 
 // -----------------------------------------------------------------
@@ -126,13 +282,9 @@ void ComputeServer::connectToClient(boost::asio::io_service* ioService, const st
 			//
 			// Request X tasks for each CPU core we have available, this allows there to be enough
 			// tasks to keep the cores busy during transport of messages back and forth, rather than
-			// serializing on message transport.
+			// serializing on message transport.  All of the credits go in the one request.
 			auto requests = unsigned int{ std::max(1u, std::thread::hardware_concurrency()) * 2 };
-			auto command = std::make_shared<Messages::TaskRequest>();
-			for (auto core : IRange<unsigned int>(1, requests))
-			{
-				Messages::send(command, socket, *ioService);
-			}
+			Messages::send(std::make_shared<Messages::TaskRequest>(requests), socket, *ioService);
 		}
 	}
 }
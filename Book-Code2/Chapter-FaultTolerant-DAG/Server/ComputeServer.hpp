@@ -12,6 +12,7 @@
 #pragma warning(pop)
 
 #include "Shared/Messages/Message.hpp"
+#include "Shared/Messages/TaskDataflow.hpp"
 
 namespace ip = boost::asio::ip;
 
@@ -31,10 +32,13 @@ public:
 private:
 	std::array<uint8_t, 1> m_messageType;
 	std::unordered_map<Messages::Type, std::function<void (std::shared_ptr<ip::tcp::socket>)>> m_messageCommand;
+	std::unordered_map<Messages::Type, std::function<void (std::shared_ptr<ip::tcp::socket>, const std::string&)>> m_batchCommand;
+	std::unordered_map<uint64_t, std::shared_ptr<Messages::TaskDataflow>> m_dataflow;	// Dataflow received ahead of its task, by task id
 
 	void prepareCommandMap();
 	void connectToClient(boost::asio::io_service* ioService, const std::string& ipClient, const std::string& portClient);
 	void handleNextTask(std::shared_ptr<ip::tcp::socket> socket);
+	void processTaskBatch(std::shared_ptr<ip::tcp::socket> socket);
 
 };
 
@@ -2,18 +2,28 @@
 #include "Shared/Threading/ThreadPool.hpp"
 
 #include <iostream>
+#include <string>
 #include <thread>
 
 #include <boost/asio.hpp>
 
 bool parseClient(int argc, char* argv[], std::string& ip, std::string& port);
+bool parsePoolSize(int argc, char* argv[], uint16_t& sizeMinimum, uint16_t& sizeMaximum);
+bool parsePlacement(int argc, char* argv[], ThreadPool::Placement& placement);
 
 int main(int argc, char* argv[])
 {
 	auto ipClient = std::string{};
 	auto portClient = std::string{};
-	if (parseClient(argc, argv, ipClient, portClient))
+	auto sizeMinimum = uint16_t{ 0 };
+	auto sizeMaximum = uint16_t{ 0 };
+	auto placement = ThreadPool::Placement::None;
+	if (parseClient(argc, argv, ipClient, portClient) &&
+		parsePoolSize(argc, argv, sizeMinimum, sizeMaximum) &&
+		parsePlacement(argc, argv, placement))
 	{
+		ThreadPool::configure(sizeMinimum, sizeMaximum, placement);
+
 	boost::asio::io_service ioService;
 	boost::asio::io_service::work work(ioService);
 
@@ -31,7 +41,7 @@ int main(int argc, char* argv[])
 	}
 	else
 	{
-		std::cout << "Incorrect command line parameters - Server <client ip> <portnum>" << std::endl;
+		std::cout << "Incorrect command line parameters - Server <client ip> <portnum> [<min threads> <max threads> [none|core|node]]" << std::endl;
 	}
 
 	return 0;
@@ -45,7 +55,7 @@ int main(int argc, char* argv[])
 bool parseClient(int argc, char* argv[], std::string& ip, std::string& port)
 {
 	auto success = bool{ false };
-	if (argc == 3)
+	if (argc == 3 || argc == 5 || argc == 6)
 	{
 		try
 		{
@@ -61,3 +71,67 @@ bool parseClient(int argc, char* argv[], std::string& ip, std::string& port)
 
 	return success;
 }
+
+// -----------------------------------------------------------------
+//
+// @details Extracts the optional thread pool size bounds from the command
+// line parameters.  When they aren't given, both are left at zero, which
+// leaves the thread pool to choose.
+//
+// -----------------------------------------------------------------
+bool parsePoolSize(int argc, char* argv[], uint16_t& sizeMinimum, uint16_t& sizeMaximum)
+{
+	auto success = bool{ argc != 5 && argc != 6 };
+	if (argc == 5 || argc == 6)
+	{
+		try
+		{
+			sizeMinimum = static_cast<uint16_t>(std::stoul(argv[3]));
+			sizeMaximum = static_cast<uint16_t>(std::stoul(argv[4]));
+			success = sizeMinimum > 0 && sizeMinimum <= sizeMaximum;
+		}
+		catch (std::exception& ex)
+		{
+			std::cout << "Unable to parse the thread pool size: " << ex.what() << std::endl;
+		}
+	}
+
+	return success;
+}
+
+// -----------------------------------------------------------------
+//
+// @details Extracts the optional worker placement from the command line
+// parameters: none, core to pin each worker to a core, or node to pin each
+// worker to a NUMA node.  When it isn't given, the placement is left alone.
+//
+// -----------------------------------------------------------------
+bool parsePlacement(int argc, char* argv[], ThreadPool::Placement& placement)
+{
+	auto success = bool{ argc != 6 };
+	if (argc == 6)
+	{
+		auto name = std::string(argv[5]);
+		if (name == "none")
+		{
+			placement = ThreadPool::Placement::None;
+			success = true;
+		}
+		else if (name == "core")
+		{
+			placement = ThreadPool::Placement::Core;
+			success = true;
+		}
+		else if (name == "node")
+		{
+			placement = ThreadPool::Placement::Node;
+			success = true;
+		}
+		else
+		{
+			std::cout << "Unknown worker placement: " << name << std::endl;
+		}
+	}
+
+	return success;
+}
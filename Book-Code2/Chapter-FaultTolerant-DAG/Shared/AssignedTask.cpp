@@ -8,25 +8,56 @@
 // is expected to complete.
 //
 // -----------------------------------------------------------------
-AssignedTask::AssignedTask(std::shared_ptr<Tasks::Task> task) :
-	m_task(task)
+AssignedTask::AssignedTask(std::shared_ptr<Tasks::Task> task, ServerID_t serverId, std::chrono::high_resolution_clock::duration timeout) :
+	m_task(task),
+	m_serverId(serverId),
+	m_timeAssigned(std::chrono::high_resolution_clock::now()),
+	m_faulted(false)
 {
 	//
 	// Set the initial deadline for when we expect to receive the next
 	// status for this task.
-	updateDeadline();
+	updateDeadline(timeout);
+}
+
+// -----------------------------------------------------------------
+//
+// @details This constructor is for a task that was already sent to the
+// server some time ago, a backup copy taking over from the first copy.
+// The task counts as assigned, and last heard from, when it was sent,
+// only the deadline starts from now.
+//
+// -----------------------------------------------------------------
+AssignedTask::AssignedTask(std::shared_ptr<Tasks::Task> task, ServerID_t serverId, std::chrono::high_resolution_clock::duration timeout, std::chrono::high_resolution_clock::time_point timeSent) :
+	m_task(task),
+	m_serverId(serverId),
+	m_deadline(std::chrono::high_resolution_clock::now() + timeout),
+	m_timeAssigned(timeSent),
+	m_lastHeard(timeSent),
+	m_faulted(false)
+{
 }
 
 // -----------------------------------------------------------------
 //
 // @details Sets the deadline for when the task is expected to report
-// in with a status message.
+// in with a status message, the timeout from now.
 //
 // -----------------------------------------------------------------
-void AssignedTask::updateDeadline()
+void AssignedTask::updateDeadline(std::chrono::high_resolution_clock::duration timeout)
 {
-	//
-	// By definition we set the new deadline to 2 seconds from now.
-	auto now = std::chrono::high_resolution_clock::now();
-	m_deadline = now + std::chrono::milliseconds(3000);
+	m_lastHeard = std::chrono::high_resolution_clock::now();
+	m_deadline = m_lastHeard + timeout;
+}
+
+// -----------------------------------------------------------------
+//
+// @details Moves the deadline to now, used when a compute server reports
+// it was unable to perform the task so that it is retried right away.
+//
+// -----------------------------------------------------------------
+void AssignedTask::expireDeadline()
+{
+	m_deadline = std::chrono::high_resolution_clock::now();
+	m_faulted = true;
 }
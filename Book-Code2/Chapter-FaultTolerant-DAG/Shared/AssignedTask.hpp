@@ -1,6 +1,7 @@
 #ifndef _ASSIGNEDTASK_HPP_
 #define _ASSIGNEDTASK_HPP_
 
+#include "Server.hpp"
 #include "Shared/Tasks/Task.hpp"
 
 #include <chrono>
@@ -12,45 +13,40 @@
 // assigned to a compute node and have not yet returned a result.  
 // As tasks are added to this set, they are time-stamped with
 // the current time and assigned a future deadline based upon the
-// task timeout.  When a result is returned from a compute 
-// node, the task is removed from this list and considered complete.
-// When the deadline for a task has passed, it is removed from
-// this list and returned back into the gloal work queue so that
-// it can be re-assigned to a new compute node.
+// task timeout, which is learned by the DeadlineEstimator.  When a
+// result is returned from a compute node, the task is removed from
+// this list and considered complete.  When the deadline for a task
+// has passed, it is removed from this list and returned back into
+// the gloal work queue so that it can be re-assigned to a new compute
+// node.
 //
-// TODO: This comment goes with the queue and the hash table.  This class
-// is really just what is contained in those data structures.  But for
-// now, this is the best place to have this comment.
+// TODO: This comment goes with the hash table and the heap of
+// deadlines.  This class is really just what is contained in those data
+// structures.  But for now, this is the best place to have this comment.
 //
 // -----------------------------------------------------------------
 class AssignedTask
 {
 public:
-	AssignedTask(std::shared_ptr<Tasks::Task> task);
+	AssignedTask(std::shared_ptr<Tasks::Task> task, ServerID_t serverId, std::chrono::high_resolution_clock::duration timeout);
+	AssignedTask(std::shared_ptr<Tasks::Task> task, ServerID_t serverId, std::chrono::high_resolution_clock::duration timeout, std::chrono::high_resolution_clock::time_point timeSent);
 
 	std::shared_ptr<Tasks::Task> getTask() { return m_task; }
-	void updateDeadline();
+	ServerID_t getServerId() { return m_serverId; }
+	void updateDeadline(std::chrono::high_resolution_clock::duration timeout);
+	void expireDeadline();
+	bool hasFaulted() { return m_faulted; }
+	std::chrono::time_point<std::chrono::high_resolution_clock> getLastHeard() { return m_lastHeard; }
 	std::chrono::time_point<std::chrono::high_resolution_clock> getDeadline() { return m_deadline; }
+	std::chrono::time_point<std::chrono::high_resolution_clock> getTimeAssigned() { return m_timeAssigned; }
 
 private:
 	std::shared_ptr<Tasks::Task> m_task;
+	ServerID_t m_serverId;
 	std::chrono::time_point<std::chrono::high_resolution_clock> m_deadline;
-};
-
-// -----------------------------------------------------------------
-//
-// @details This class is used to compare assigned tasks for priority
-// based upon their deadline.
-//
-// -----------------------------------------------------------------
-struct AssignedTaskCompare
-{
-	bool operator()(const std::shared_ptr<AssignedTask>& lhs, const std::shared_ptr<AssignedTask>& rhs) const
-	{
-		//
-		// Items with a closer dealine have higher priority.
-		return (lhs->getDeadline() > rhs->getDeadline());
-	}
+	std::chrono::time_point<std::chrono::high_resolution_clock> m_timeAssigned;
+	std::chrono::time_point<std::chrono::high_resolution_clock> m_lastHeard;	// Assigned, or the last status from the server
+	bool m_faulted;
 };
 
 #endif // _ASSIGNEDTASK_HPP_
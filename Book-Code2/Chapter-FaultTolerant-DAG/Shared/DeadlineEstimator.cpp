@@ -0,0 +1,118 @@
+#include "DeadlineEstimator.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+const std::chrono::milliseconds DeadlineEstimator::DEFAULT_TIMEOUT(3000);
+const std::chrono::milliseconds DeadlineEstimator::MIN_TIMEOUT(200);
+const std::chrono::milliseconds DeadlineEstimator::MAX_TIMEOUT(60000);
+
+namespace
+{
+	//
+	// Same gains TCP uses for its round trip time estimates
+	const auto MEAN_GAIN = 1.0 / 8.0;
+	const auto DEVIATION_GAIN = 1.0 / 4.0;
+	const auto DEVIATION_SCALE = 4.0;
+
+	double toSeconds(std::chrono::high_resolution_clock::duration duration)
+	{
+		return std::chrono::duration<double>(duration).count();
+	}
+}
+
+// -----------------------------------------------------------------
+//
+// @details Adds the time between hearing about a task of the type from the
+// server, either a status or the result, to the estimate.
+//
+// -----------------------------------------------------------------
+void DeadlineEstimator::addSample(ServerID_t serverId, std::type_index type, Clock::duration interval)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	auto sample = toSeconds(interval);
+	auto key = Key{ serverId, type };
+	auto it = m_states.find(key);
+	if (it == m_states.end())
+	{
+		m_states.insert(std::make_pair(key, State{ sample, sample / 2, 0, 1 }));
+		it = m_states.find(key);
+	}
+	else
+	{
+		auto& state = it->second;
+		state.deviation += DEVIATION_GAIN * (std::abs(sample - state.mean) - state.deviation);
+		state.mean += MEAN_GAIN * (sample - state.mean);
+		state.samples++;
+	}
+	it->second.timeout = computeTimeout(it->second);
+}
+
+// -----------------------------------------------------------------
+//
+// @details Called when the deadline for a task of the type on the server
+// has passed, doubles the timeout.
+//
+// -----------------------------------------------------------------
+void DeadlineEstimator::backoff(ServerID_t serverId, std::type_index type)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	auto it = m_states.find(Key{ serverId, type });
+	if (it != m_states.end())
+	{
+		it->second.timeout = std::min(it->second.timeout * 2, toSeconds(MAX_TIMEOUT));
+	}
+}
+
+// -----------------------------------------------------------------
+//
+// @details Returns how long to wait to next hear about a task of the type
+// on the server.
+//
+// -----------------------------------------------------------------
+DeadlineEstimator::Clock::duration DeadlineEstimator::getTimeout(ServerID_t serverId, std::type_index type)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	auto it = m_states.find(Key{ serverId, type });
+	if (it == m_states.end())
+	{
+		return DEFAULT_TIMEOUT;
+	}
+
+	return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(it->second.timeout));
+}
+
+// -----------------------------------------------------------------
+//
+// @details Returns the current estimates, for reporting.
+//
+// -----------------------------------------------------------------
+std::vector<DeadlineEstimator::Estimate> DeadlineEstimator::getEstimates()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	std::vector<Estimate> estimates;
+	estimates.reserve(m_states.size());
+	for (const auto& state : m_states)
+	{
+		estimates.push_back(Estimate{ state.first.serverId, state.first.type.name(), state.second.mean, state.second.deviation, state.second.timeout, state.second.samples });
+	}
+
+	return estimates;
+}
+
+// -----------------------------------------------------------------
+//
+// @details The mean interval plus four deviations, kept within the
+// minimum and maximum timeouts.
+//
+// -----------------------------------------------------------------
+double DeadlineEstimator::computeTimeout(const State& state)
+{
+	auto timeout = state.mean + DEVIATION_SCALE * state.deviation;
+
+	return std::max(toSeconds(MIN_TIMEOUT), std::min(timeout, toSeconds(MAX_TIMEOUT)));
+}
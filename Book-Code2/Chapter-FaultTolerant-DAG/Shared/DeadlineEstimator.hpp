@@ -0,0 +1,80 @@
+#ifndef _DEADLINEESTIMATOR_HPP_
+#define _DEADLINEESTIMATOR_HPP_
+
+#include "Server.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <typeindex>
+#include <unordered_map>
+#include <vector>
+
+// -----------------------------------------------------------------
+//
+// @details Learns how long to wait to hear about an assigned task before
+// giving up on it, for each compute server and type of task.  While a
+// task runs, its server sends a status every so often, and finally the
+// result.  The time between hearing about a task is smoothed the same way
+// TCP estimates its retransmission timeout: a moving average of the
+// interval plus four times its moving mean deviation.  Until the first
+// interval is seen, the fixed default timeout is used.
+//
+// A task whose deadline passes may only have been slow, so the timeout is
+// doubled each time that happens, until the next interval brings it back
+// to what is being measured.
+//
+// -----------------------------------------------------------------
+class DeadlineEstimator
+{
+public:
+	using Clock = std::chrono::high_resolution_clock;
+
+	struct Estimate
+	{
+		ServerID_t serverId;
+		std::string taskType;
+		double mean;			// Seconds between hearing about a task
+		double deviation;		// Seconds
+		double timeout;			// Seconds
+		uint32_t samples;
+	};
+
+	void addSample(ServerID_t serverId, std::type_index type, Clock::duration interval);
+	void backoff(ServerID_t serverId, std::type_index type);
+	Clock::duration getTimeout(ServerID_t serverId, std::type_index type);
+	std::vector<Estimate> getEstimates();
+
+	static const std::chrono::milliseconds DEFAULT_TIMEOUT;
+	static const std::chrono::milliseconds MIN_TIMEOUT;
+	static const std::chrono::milliseconds MAX_TIMEOUT;
+
+private:
+	struct Key
+	{
+		ServerID_t serverId;
+		std::type_index type;
+
+		bool operator==(const Key& rhs) const { return serverId == rhs.serverId && type == rhs.type; }
+	};
+	struct KeyHash
+	{
+		std::size_t operator()(const Key& key) const { return std::hash<std::type_index>()(key.type) ^ (static_cast<std::size_t>(key.serverId) << 1); }
+	};
+	struct State
+	{
+		double mean;
+		double deviation;
+		double timeout;
+		uint32_t samples;
+	};
+
+	std::unordered_map<Key, State, KeyHash> m_states;
+	std::mutex m_mutex;
+
+	static double computeTimeout(const State& state);
+};
+
+#endif // _DEADLINEESTIMATOR_HPP_
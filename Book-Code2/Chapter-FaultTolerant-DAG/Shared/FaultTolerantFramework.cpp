@@ -124,23 +124,31 @@ void FaultTolerantFramework::prepareInternalHandlers()
 		{
 			auto taskRequest = Messages::TaskRequest{};
 
-			// Finish reading the task request and then place the
-			// request on the queue so that it can be filled when a task
-			// becomes available.
+			// Finish reading the task request and then add its credits
+			// to those of the server, so they can be filled when tasks
+			// become available.
 			Messages::read(taskRequest, m_servers.get(serverId)->socket);
-			TaskRequestQueue::instance()->enqueueRequest(serverId);
+			TaskRequestQueue::instance()->enqueueRequest(serverId, taskRequest.getCredits());
 		};
 
 	//
 	// The TaskStatus handler reports to the TaskRequestQueue it has received
-	// a status update for the task.
+	// a status update for the task.  A fault means the server gave up on the
+	// task, so it gets rescheduled right away.
 	m_messageCommand[Messages::Type::TaskStatus] =
 		[this](ServerID_t serverId)
 		{
 			auto taskStatus = Messages::TaskStatus{};
 
 			Messages::read(taskStatus, m_servers.get(serverId)->socket);
-			TaskRequestQueue::instance()->touchTask(taskStatus.getTaskId());
+			if (taskStatus.getStatus() == PBMessages::TaskStatus_Status_Fault)
+			{
+				TaskRequestQueue::instance()->failTask(taskStatus.getTaskId());
+			}
+			else
+			{
+				TaskRequestQueue::instance()->touchTask(taskStatus.getTaskId());
+			}
 		};
 }
 
@@ -227,6 +235,10 @@ void FaultTolerantFramework::handleNextMessage(ServerID_t serverId)
 				std::cout << "--- COMM Error ---" << std::endl;
 				server->socket->shutdown(boost::asio::socket_base::shutdown_both);
 				server->socket->close();
+				//
+				// Get the work the server had going out to the others right away
+				m_servers.remove(serverId);
+				TaskRequestQueue::instance()->removeServer(serverId);
 			}
 		});
 }
@@ -38,6 +38,8 @@ public:
 	bool initialize();
 	void terminate();
 
+	std::unordered_map<ServerID_t, Server> getServers()	{ return m_servers.getServers(); }
+
 	template<typename Message>
 	void registerHandler(Messages::Type type, std::function<void(std::shared_ptr<Message>)> handler)
 	{
@@ -51,7 +53,8 @@ public:
 
 			//
 			// Let the task queue know this task result has been recieved
-			if (TaskRequestQueue::instance()->finalizeTask(message->getTaskId(), true, true))
+			TaskRequestQueue::instance()->recordResult(message->getTaskId(), serverId, *message);
+			if (TaskRequestQueue::instance()->finalizeTask(message->getTaskId(), serverId, true, true))
 			{
 				handler(message);
 			}
@@ -4,7 +4,7 @@
 #include <chrono>
 #include <iostream>
 #include <iomanip>
-
+#include <sstream>
 
 namespace Messages
 {
@@ -157,4 +157,32 @@ namespace Messages
 			}
 		}
 	}
+
+	// -----------------------------------------------------------------
+	//
+	// @details Returns the body of the message, in the same form it would
+	// be sent over a socket, but without the type and size header.  This
+	// is used to carry the result of one task as the input to another.
+	//
+	// -----------------------------------------------------------------
+	std::shared_ptr<const std::string> serialize(const Message& message)
+	{
+		std::ostringstream os;
+		message.serializeToOstream(&os);
+
+		return std::make_shared<const std::string>(os.str());
+	}
+
+	// -----------------------------------------------------------------
+	//
+	// @details The reverse of serialize, fills in the message from a
+	// previously serialized body.
+	//
+	// -----------------------------------------------------------------
+	bool parse(Message& message, const std::string& payload)
+	{
+		std::istringstream is(payload);
+
+		return message.parseFromIstream(&is);
+	}
 }
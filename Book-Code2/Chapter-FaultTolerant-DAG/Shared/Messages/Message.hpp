@@ -5,7 +5,9 @@
 
 #include <array>
 #include <functional>
+#include <memory>
 #include <ostream>
+#include <string>
 
 //
 // Disable some compiler warnings that come from boost
@@ -35,9 +37,13 @@ namespace Messages
 
 		virtual ~Message() {}	// Virtual destructor to allow derived destructors to be called
 
+		Type getType() const	{ return static_cast<Type>(m_type[0]); }
+
 	private:
 		friend void send(std::shared_ptr<Message> message, std::shared_ptr<ip::tcp::socket> socket, std::function<void(bool)> onComplete);
 		friend void read(Message& message, std::shared_ptr<ip::tcp::socket> socket);
+		friend std::shared_ptr<const std::string> serialize(const Message& message);
+		friend bool parse(Message& message, const std::string& payload);
 
 		virtual uint32_t getMessageSize() = 0;
 		virtual bool serializeToOstream(std::ostream* output) const = 0;
@@ -51,6 +57,9 @@ namespace Messages
 	void send(std::shared_ptr<Message> message, const std::shared_ptr<ip::tcp::socket> socket, boost::asio::strand& strand, std::function<void(bool)> onComplete = [](bool) {});
 
 	void read(Message& message, std::shared_ptr<ip::tcp::socket> socket);
+
+	std::shared_ptr<const std::string> serialize(const Message& message);
+	bool parse(Message& message, const std::string& payload);
 }
 
 #endif // _MESSAGE_HPP_
@@ -25,7 +25,9 @@ namespace Messages
 		DAGExample,
 		DAGExampleResult,
 		TerminateCommand,
-		TaskStatus
+		TaskStatus,
+		TaskDataflow,
+		TaskBatch
 	};
 }
 
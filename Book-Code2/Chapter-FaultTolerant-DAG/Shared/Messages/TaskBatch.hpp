@@ -0,0 +1,43 @@
+#ifndef _TASKBATCH_HPP_
+#define _TASKBATCH_HPP_
+
+#include "MessagePBMixIn.hpp"
+
+//
+// Google Protocol Buffers cause hella warnings, ignore them
+#pragma warning(push, 0)
+#include "TaskBatch.pb.h"
+#pragma warning(pop)
+
+namespace Messages
+{
+	// -----------------------------------------------------------------
+	//
+	// @details This message carries several messages for the same compute
+	// server in a single write.  Each entry is the type and serialized body
+	// of a message, in the order the messages would otherwise have been
+	// sent one at a time, so a task's dataflow message still comes ahead of
+	// the task.
+	//
+	// -----------------------------------------------------------------
+	class TaskBatch : public MessagePBMixIn<PBMessages::TaskBatch>
+	{
+	public:
+		TaskBatch() :
+			MessagePBMixIn(Messages::Type::TaskBatch)
+		{
+		}
+
+		void add(const Message& message)
+		{
+			auto entry = m_message.add_entries();
+			entry->set_type(static_cast<uint32_t>(message.getType()));
+			entry->set_body(*serialize(message));
+		}
+
+		int getSize()												{ return m_message.entries_size(); }
+		const google::protobuf::RepeatedPtrField<PBMessages::TaskBatch_Entry>& getEntries()	{ return m_message.entries(); }
+	};
+}
+
+#endif // _TASKBATCH_HPP_
@@ -0,0 +1,60 @@
+#ifndef _TASKDATAFLOW_HPP_
+#define _TASKDATAFLOW_HPP_
+
+#include "MessagePBMixIn.hpp"
+
+//
+// Google Protocol Buffers cause hella warnings, ignore them
+#pragma warning(push, 0)
+#include "TaskDataflow.pb.h"
+#pragma warning(pop)
+
+#include <memory>
+#include <string>
+
+namespace Messages
+{
+	// -----------------------------------------------------------------
+	//
+	// @details This message is sent to a compute server just ahead of a
+	// task that takes part in dataflow, or that isn't of normal priority.  It
+	// tells the server whether to hold on to the result of the task, which
+	// earlier results the task needs as input, and the priority of the task.
+	// An input carries its payload only when the client doesn't expect the
+	// server to already have it.
+	//
+	// -----------------------------------------------------------------
+	class TaskDataflow : public MessagePBMixIn<PBMessages::TaskDataflow>
+	{
+	public:
+		TaskDataflow() :
+			MessagePBMixIn(Messages::Type::TaskDataflow)
+		{
+		}
+
+		TaskDataflow(uint64_t taskId, bool retainResult, uint32_t priority) :
+			MessagePBMixIn(Messages::Type::TaskDataflow)
+		{
+			m_message.set_taskid(taskId);
+			m_message.set_retainresult(retainResult);
+			m_message.set_priority(priority);
+		}
+
+		void addInput(uint64_t sourceId, std::shared_ptr<const std::string> payload)
+		{
+			auto input = m_message.add_inputs();
+			input->set_sourceid(sourceId);
+			if (payload)
+			{
+				input->set_payload(*payload);
+			}
+		}
+
+		uint64_t getTaskId()												{ return m_message.taskid(); }
+		bool getRetainResult()												{ return m_message.retainresult(); }
+		uint32_t getPriority()												{ return m_message.priority(); }
+		const google::protobuf::RepeatedPtrField<PBMessages::TaskDataflow_Input>& getInputs()	{ return m_message.inputs(); }
+	};
+}
+
+#endif // _TASKDATAFLOW_HPP_
@@ -13,8 +13,9 @@ namespace Messages
 {
 	// -----------------------------------------------------------------
 	//
-	// @details This message is used to indicate an available CPU core
-	// on a compute node.
+	// @details This message is used to give the client credit for some
+	// number of tasks a compute node is ready to take on.  Each task the
+	// client sends uses up one credit.
 	//
 	// -----------------------------------------------------------------
 	class TaskRequest : public MessagePBMixIn<PBMessages::TaskRequest>
@@ -24,6 +25,14 @@ namespace Messages
 			MessagePBMixIn(Messages::Type::TaskRequest)
 		{
 		}
+
+		TaskRequest(uint32_t credits) :
+			MessagePBMixIn(Messages::Type::TaskRequest)
+		{
+			m_message.set_credits(credits);
+		}
+
+		uint32_t getCredits()	{ return m_message.credits(); }
 	};
 }
 
@@ -0,0 +1,70 @@
+#include "ResultCache.hpp"
+
+std::shared_ptr<ResultCache> ResultCache::m_instance = nullptr;
+
+// -----------------------------------------------------------------
+//
+// @details This is the Singleton 'instance' accessor
+//
+// -----------------------------------------------------------------
+ResultCache* ResultCache::instance()
+{
+	if (m_instance)		return m_instance.get();
+
+	m_instance = std::shared_ptr<ResultCache>(new ResultCache());
+
+	return m_instance.get();
+}
+
+// -----------------------------------------------------------------
+//
+// @details Adds the result for a task, dropping the oldest results
+// until everything fits within the capacity.
+//
+// -----------------------------------------------------------------
+void ResultCache::add(uint64_t taskId, std::shared_ptr<const std::string> payload)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	auto existing = m_results.find(taskId);
+	if (existing != m_results.end())
+	{
+		//
+		// A retried task may complete here more than once, keep the newest result
+		m_size -= existing->second->size();
+		existing->second = payload;
+	}
+	else
+	{
+		m_results[taskId] = payload;
+		m_order.push_back(taskId);
+	}
+	m_size += payload->size();
+
+	while (m_size > CAPACITY_BYTES && m_order.size() > 1)
+	{
+		auto oldest = m_results.find(m_order.front());
+		m_size -= oldest->second->size();
+		m_results.erase(oldest);
+		m_order.pop_front();
+	}
+}
+
+// -----------------------------------------------------------------
+//
+// @details Returns the result for the task, or a nullptr if it isn't
+// (or is no longer) in the cache.
+//
+// -----------------------------------------------------------------
+std::shared_ptr<const std::string> ResultCache::get(uint64_t taskId)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	auto result = m_results.find(taskId);
+	if (result == m_results.end())
+	{
+		return nullptr;
+	}
+
+	return result->second;
+}
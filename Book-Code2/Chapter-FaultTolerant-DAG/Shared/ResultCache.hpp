@@ -0,0 +1,46 @@
+#ifndef _RESULTCACHE_HPP_
+#define _RESULTCACHE_HPP_
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// -----------------------------------------------------------------
+//
+// @details This class is used by a compute server to hold on to the
+// serialized results of tasks that other tasks depend upon for input.
+// When a dependent task is sent to the same server, the client leaves
+// the input out of the message and the server takes it from here instead.
+//
+// The cache is limited in size, the oldest results are dropped first.  A
+// result that has been dropped is simply a miss; the client finds out and
+// sends the task again with the input included.
+//
+// -----------------------------------------------------------------
+class ResultCache
+{
+public:
+	static ResultCache* instance();
+
+	void add(uint64_t taskId, std::shared_ptr<const std::string> payload);
+	std::shared_ptr<const std::string> get(uint64_t taskId);
+
+protected:
+	ResultCache() : m_size(0)
+	{
+	}
+
+private:
+	static std::shared_ptr<ResultCache> m_instance;
+	static const std::size_t CAPACITY_BYTES = 64 * 1024 * 1024;
+
+	std::unordered_map<uint64_t, std::shared_ptr<const std::string>> m_results;
+	std::deque<uint64_t> m_order;		// Task ids, oldest first
+	std::size_t m_size;					// Total bytes of all results held
+	std::mutex m_mutex;
+};
+
+#endif // _RESULTCACHE_HPP_
@@ -23,15 +23,23 @@ typedef uint16_t ServerID_t;
 // server that is used as a lookup id (think hash table) for referencing
 // the details of the server.
 //
+// The time the server takes to return results is kept as an exponentially
+// weighted moving average, along with a count of the results, both are
+// updated by the ServerSet.
+//
 // -----------------------------------------------------------------
 struct Server
 {
-	Server() 
+	Server() :
+		serviceTime(0),
+		completed(0)
 	{
 	}
 
 	Server(std::shared_ptr<ip::tcp::socket> socket) :
-		socket(socket)
+		socket(socket),
+		serviceTime(0),
+		completed(0)
 	{
 		static auto newId = ServerID_t{ 0 };
 		this->id = newId++;
@@ -43,6 +51,9 @@ struct Server
 	std::shared_ptr<ip::tcp::socket> socket;
 	std::shared_ptr<boost::asio::strand> strand;
 	std::array<uint8_t, 1> messageType;			// Used to accept the incoming message type
+
+	double serviceTime;							// Seconds from sending a task to its result, per unit of task cost, 0 until measured
+	uint64_t completed;							// Number of results returned
 };
 
 #endif // _SERVER_HPP_
@@ -1,5 +1,19 @@
 #include "ServerSet.hpp"
 
+#include <algorithm>
+
+namespace
+{
+	//
+	// Weight given to the newest sample in the moving averages
+	const auto SMOOTHING_WEIGHT = 0.2;
+
+	double smooth(double average, double sample)
+	{
+		return (average == 0) ? sample : average + SMOOTHING_WEIGHT * (sample - average);
+	}
+}
+
 // -----------------------------------------------------------------
 //
 // @details Adds a new server to the set.
@@ -9,28 +23,41 @@ void ServerSet::add(Server server)
 {
 	std::lock_guard<std::mutex> lock(m_mutex);
 
-	m_servers[server.id] = server;
+	m_servers[server.id] = std::make_shared<Server>(server);
 }
 
 // -----------------------------------------------------------------
 //
-// @details Returns a reference to the requested server, based upon id.
-// A boost::optional return is used and set to true/false depending
-// upon whether or not the server id was found.
+// @details Returns the requested server, based upon id, or nullptr if
+// the server id was not found.  The server is shared with the caller, so
+// it stays valid for as long as the caller holds on to it, even if the
+// server is removed from the set in the meantime.
 //
 // -----------------------------------------------------------------
-boost::optional<Server&> ServerSet::get(ServerID_t id)
+std::shared_ptr<Server> ServerSet::get(ServerID_t id)
 {
 	std::lock_guard<std::mutex> lock(m_mutex);
 
-	auto server = boost::optional<Server&>();
 	auto it = m_servers.find(id);
-	if (it != m_servers.end())
+	return (it != m_servers.end()) ? it->second : nullptr;
+}
+
+// -----------------------------------------------------------------
+//
+// @details Returns a copy of each of the servers, as they are right now.
+//
+// -----------------------------------------------------------------
+std::unordered_map<ServerID_t, Server> ServerSet::getServers()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	std::unordered_map<ServerID_t, Server> servers;
+	for (const auto& server : m_servers)
 	{
-		server = it->second;
+		servers.emplace(server.first, *server.second);
 	}
 
-	return server;
+	return servers;
 }
 
 // -----------------------------------------------------------------
@@ -48,34 +75,50 @@ bool ServerSet::exists(ServerID_t id)
 
 // -----------------------------------------------------------------
 //
-// @details This method goes through and removes any servers whose
-// sockets are no longer open.  The return value is the set of
-// servers removed.
+// @details Removes the server from the set, called once its connection
+// has been lost.
 //
 // -----------------------------------------------------------------
-std::unordered_set<ServerID_t> ServerSet::removeDisconnected()
+void ServerSet::remove(ServerID_t id)
 {
 	std::lock_guard<std::mutex> lock(m_mutex);
 
-	//
-	// Find servers with disconnected sockets first
-	// Note: Can not use std::remove_if with associative containers.  Therefore,
-	// doing this in two steps.
-	auto removeMe = std::unordered_set<ServerID_t>();
-	for (auto server : m_servers)
-	{
-		if (!server.second.socket->is_open())
-		{
-			removeMe.insert(server.first);
-		}
-	}
+	m_servers.erase(id);
+}
 
-	//
-	// Then remove them from our list
-	for (auto server : removeMe)
+// -----------------------------------------------------------------
+//
+// @details Updates the moving average for the server with a result that
+// has just come back.  The service time is divided by the cost of the
+// task, so servers can be compared no matter what they have been given.
+//
+// -----------------------------------------------------------------
+void ServerSet::recordCompletion(ServerID_t id, std::chrono::high_resolution_clock::duration serviceTime, uint32_t cost)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	auto it = m_servers.find(id);
+	if (it == m_servers.end())
 	{
-		m_servers.erase(server);
+		return;
 	}
+	auto& server = *it->second;
 
-	return std::move(removeMe);
+	auto seconds = std::chrono::duration<double>(serviceTime).count();
+	server.serviceTime = smooth(server.serviceTime, seconds / std::max(cost, 1u));
+	server.completed++;
+}
+
+// -----------------------------------------------------------------
+//
+// @details Returns the smoothed seconds per unit of task cost for the
+// server, or 0 if it hasn't returned any results yet.
+//
+// -----------------------------------------------------------------
+double ServerSet::getServiceTime(ServerID_t id)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	auto it = m_servers.find(id);
+	return (it != m_servers.end()) ? it->second->serviceTime : 0;
 }
@@ -3,10 +3,10 @@
 
 #include "Server.hpp"
 
+#include <chrono>
 #include <memory>
 #include <mutex>
 #include <unordered_map>
-#include <unordered_set>
 
 //
 // Disable some compiler warnings that come from boost
@@ -14,7 +14,6 @@
 #pragma warning(disable : 4267)
 #pragma warning(disable : 4996)
 #include <boost/asio.hpp>
-#include <boost/optional.hpp>
 #pragma warning(pop)
 
 namespace ip = boost::asio::ip;
@@ -30,18 +29,17 @@ class ServerSet
 {
 public:
 	void add(Server server);
-	boost::optional<Server&> get(ServerID_t id);
+	std::shared_ptr<Server> get(ServerID_t id);
 	bool exists(ServerID_t id);
-	std::unordered_map<ServerID_t, Server> getServers() 
-	{ 
-		std::lock_guard<std::mutex> lock(m_mutex);
-		return m_servers; 
-	}
-	std::unordered_set<ServerID_t> removeDisconnected();
+	std::unordered_map<ServerID_t, Server> getServers();
+	void remove(ServerID_t id);
+
+	void recordCompletion(ServerID_t id, std::chrono::high_resolution_clock::duration serviceTime, uint32_t cost);
+	double getServiceTime(ServerID_t id);
 
 
 private:
-	std::unordered_map<ServerID_t, Server> m_servers;
+	std::unordered_map<ServerID_t, std::shared_ptr<Server>> m_servers;
 	std::mutex m_mutex;
 };
 
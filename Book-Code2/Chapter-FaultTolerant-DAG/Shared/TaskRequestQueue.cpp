@@ -1,11 +1,28 @@
 #include "TaskRequestQueue.hpp"
 
+#include "Shared/Messages/TaskBatch.hpp"
+#include "Shared/Messages/TaskStatus.hpp"
+
+#include <algorithm>
 #include <chrono>
 #include <iostream>
 #include <iomanip>
+#include <limits>
+#include <typeindex>
 
 std::shared_ptr<TaskRequestQueue> TaskRequestQueue::m_instance = nullptr;
 
+namespace
+{
+	//
+	// Most tasks sent to a server in one batch
+	const auto TASK_BATCH_MOST = uint32_t{ 32 };
+	//
+	// How many times longer than the fastest idle server is expected to take
+	// an assigned task has to have been running to get a backup copy.
+	const auto SPECULATE_SLOWDOWN = 2.0;
+}
+
 // ------------------------------------------------------------------
 //
 // @details Protected constructor used to initialize the single
@@ -13,6 +30,9 @@ std::shared_ptr<TaskRequestQueue> TaskRequestQueue::m_instance = nullptr;
 //
 // ------------------------------------------------------------------
 TaskRequestQueue::TaskRequestQueue() :
+m_taskSignaled(false),
+m_wakeAt(std::chrono::high_resolution_clock::time_point::max()),
+m_wantCredits(false),
 m_distributerDone(false)
 {
 }
@@ -59,30 +79,94 @@ void TaskRequestQueue::initialize(boost::asio::io_service* ioService, ServerSet*
 void TaskRequestQueue::terminate()
 {
 	m_distributerDone = true;
+	wakeDistributer();
+
+	m_distributer->join();
+}
+
+// ------------------------------------------------------------------
+//
+// @details This adds the credits of a task request to those of the
+// server, putting the server in line if it didn't have any left.  The
+// distributer is only woken if it is waiting on credits.
+//
+// ------------------------------------------------------------------
+void TaskRequestQueue::enqueueRequest(ServerID_t request, uint32_t credits)
+{
+	if (credits == 0 || !m_servers->exists(request))
 	{
-		std::unique_lock<std::mutex> lock(m_mutexEventTask);
-		m_eventTask.notify_all();
+		return;
 	}
+
+	std::unique_lock<std::mutex> lock(m_mutexRequest);
+
+	auto& available = m_credits[request];
+	if (available == 0)
 	{
-		std::unique_lock<std::mutex> lock(m_mutexEventRequest);
-		m_eventRequest.notify_all();
+		m_queueRequest.push_back(request);
+	}
+	available += credits;
+	lock.unlock();
+	//
+	// The distributer is waiting on credits, either to send out work or to
+	// back up a straggler
+	if (m_wantCredits)
+	{
+		wakeDistributer();
 	}
-
-	m_distributer->join();
 }
 
 // ------------------------------------------------------------------
 //
-// @details This places a new task request on the request queue.  An event
-// will be signaled to one of the waiting threads.
+// @details Called when the connection to a server has been lost.  Its
+// credits are dropped and every task assigned to it goes straight back on
+// the ready queue of the DAG, rather than waiting out its deadline.  A
+// task with a backup copy running elsewhere is handed over to the backup
+// instead, and backups that were running on the server are forgotten.
 //
 // ------------------------------------------------------------------
-void TaskRequestQueue::enqueueRequest(ServerID_t request)
+void TaskRequestQueue::removeServer(ServerID_t serverId)
 {
-	std::unique_lock<std::mutex> lock(m_mutexRequest);
+	{
+		std::lock_guard<std::mutex> lock(m_mutexRequest);
+
+		m_credits.erase(serverId);
+		m_queueRequest.erase(std::remove(m_queueRequest.begin(), m_queueRequest.end(), serverId), m_queueRequest.end());
+	}
+
+	{
+		std::lock_guard<std::recursive_mutex> lock(m_mutexAssigned);
+
+		for (auto backup = m_backups.begin(); backup != m_backups.end(); )
+		{
+			backup = (backup->second.server == serverId) ? m_backups.erase(backup) : std::next(backup);
+		}
+
+		auto index = m_assignedByServer.find(serverId);
+		if (index != m_assignedByServer.end())
+		{
+			auto entries = std::move(index->second);
+			m_assignedByServer.erase(index);
+			for (const auto& entry : entries)
+			{
+				auto assigned = m_mapAssigned.find(entry.second);
+				auto task = assigned->second->getTask();
+				auto backup = m_backups.find(entry.second);
+				if (backup != m_backups.end())
+				{
+					trackAssigned(makeAssigned(task, backup->second));
+					m_backups.erase(backup);
+				}
+				else
+				{
+					untrackAssigned(assigned);
+					m_queueTasks.requeue(task);
+				}
+			}
+		}
+	}
 
-	m_queueRequest.push(request);
-	m_eventRequest.notify_one();
+	wakeDistributer();
 }
 
 // ------------------------------------------------------------------
@@ -97,8 +181,7 @@ void TaskRequestQueue::enqueueTask(std::shared_ptr<Tasks::Task> source)
 	//std::cout << "Enqueued Task" << std::fixed << std::setprecision(10) << (now.time_since_epoch().count() / 1000000000.0) << std::endl;
 
 	m_queueTasks.addNode(source);
-	std::unique_lock<std::mutex> lock(m_mutexEventTask);
-	m_eventTask.notify_all();
+	wakeDistributer();
 }
 
 // ------------------------------------------------------------------
@@ -110,63 +193,152 @@ void TaskRequestQueue::enqueueTask(std::shared_ptr<Tasks::Task> source)
 void TaskRequestQueue::enqueueTask(std::shared_ptr<Tasks::Task> source, std::shared_ptr<Tasks::Task> dependent)
 {
 	m_queueTasks.addEdge(source, dependent);
-	std::unique_lock<std::mutex> lock(m_mutexEventTask);
-	m_eventTask.notify_all();
+	wakeDistributer();
+}
+
+// ------------------------------------------------------------------
+//
+// @details This places a set of tasks, along with the dependencies among
+// them, on the working queue all at once.  The graph is expected to have
+// been built up before calling, so the work queue is only locked long
+// enough to link the tasks in.
+//
+// ------------------------------------------------------------------
+void TaskRequestQueue::enqueueGraph(const GraphBuilder<std::shared_ptr<Tasks::Task>>& graph)
+{
+	m_queueTasks.splice(graph);
+	wakeDistributer();
+}
+
+// ------------------------------------------------------------------
+//
+// @details This places a new task, with a dependent that also takes the
+// result of the source task as an input.  The dependent can get at the
+// result through its .getInputs once it is running on a compute server.
+//
+// ------------------------------------------------------------------
+void TaskRequestQueue::enqueueDataflow(std::shared_ptr<Tasks::Task> source, std::shared_ptr<Tasks::Task> dependent)
+{
+	source->setRetainResult(true);
+	dependent->addInput(source->getId());
+	{
+		std::lock_guard<std::mutex> lock(m_mutexDataflow);
+		m_dataflow[source->getId()].consumers++;
+	}
+
+	enqueueTask(source, dependent);
 }
 
 // ------------------------------------------------------------------
 //
 // @details This is called when a status message for a task is recieved.
 // The task tracking is updated with the time the status message was
-// received.
+// received.  The time since last hearing about the task is learned
+// from, and the deadline is set from what has been learned.  A learned
+// timeout can be shorter than the one being waited on, so the distributer
+// may need to be woken up.
 //
 // ------------------------------------------------------------------
 void TaskRequestQueue::touchTask(uint64_t taskId)
 {
-	std::lock_guard<std::recursive_mutex> lock(m_mutexAssigned);
+	auto deadline = std::chrono::high_resolution_clock::time_point::max();
+	{
+		std::lock_guard<std::recursive_mutex> lock(m_mutexAssigned);
+
+		auto task = m_mapAssigned.find(taskId);
+		if (task != m_mapAssigned.end())
+		{
+			heardFrom(*task->second);
+			task->second->updateDeadline(m_estimator.getTimeout(task->second->getServerId(), typeid(*task->second->getTask())));
+			deadline = task->second->getDeadline();
+			m_deadlines.set(taskId, deadline);
+		}
+	}
+
+	wakeDistributer(deadline);
+}
 
-	auto task = m_mapAssigned.find(taskId);
-	if (task != m_mapAssigned.end())
+// ------------------------------------------------------------------
+//
+// @details This is called when a compute server reports it was unable to
+// perform the task, typically because an input it expected to have cached
+// was no longer there.  The deadline is moved up so the task is retried
+// right away, instead of waiting for the deadline to pass.
+//
+// ------------------------------------------------------------------
+void TaskRequestQueue::failTask(uint64_t taskId)
+{
 	{
-		task->second->updateDeadline();
-		//
-		// With a new deadline, have to update the priority queue
-		auto handle = m_pqHandles[taskId];
-		m_queueAssigned.decrease(handle, task->second);
+		std::lock_guard<std::recursive_mutex> lock(m_mutexAssigned);
+
+		auto task = m_mapAssigned.find(taskId);
+		if (task != m_mapAssigned.end())
+		{
+			task->second->expireDeadline();
+			m_deadlines.set(taskId, task->second->getDeadline());
+		}
+	}
+
+	wakeDistributer();
+}
+
+// ------------------------------------------------------------------
+//
+// @details Called with each result as it arrives, before the task is
+// finalized.  If the task is the source of a dataflow edge, the result
+// and the server that produced it are kept for use by its dependents.
+//
+// ------------------------------------------------------------------
+void TaskRequestQueue::recordResult(uint64_t taskId, ServerID_t serverId, const Messages::Message& result)
+{
+	std::lock_guard<std::mutex> lock(m_mutexDataflow);
+
+	auto source = m_dataflow.find(taskId);
+	if (source != m_dataflow.end())
+	{
+		source->second.produced = true;
+		source->second.server = serverId;
+		source->second.payload = Messages::serialize(result);
 	}
 }
 
 // ------------------------------------------------------------------
 //
 // @details This is used to inform that the result for this task
-// has been returned and that it can be removed from the list of outstanding
-// results.
+// has been returned by the server and that it can be removed from the
+// list of outstanding results.
 //
 // ------------------------------------------------------------------
-bool TaskRequestQueue::finalizeTask(uint64_t id, bool dagRemove, bool forceRemove)
+bool TaskRequestQueue::finalizeTask(uint64_t id, ServerID_t serverId, bool dagRemove, bool forceRemove)
 {
 	std::lock_guard<std::recursive_mutex> lock(m_mutexAssigned);
 	auto removed = bool{ false };
 
+	auto now = std::chrono::high_resolution_clock::now();
 	auto it = m_mapAssigned.find(id);
 	if (it != m_mapAssigned.end())
 	{
 		//
-		// Inform the DAG this task is done and can be removed
+		// Inform the DAG this task is done and can be removed, and count the result
+		// toward the speed of the server it came from, which may be running a backup.
 		if (dagRemove)
 		{
+			auto backup = m_backups.find(id);
+			auto timeSent = (backup != m_backups.end() && backup->second.server == serverId) ? backup->second.timeSent : it->second->getTimeAssigned();
 			m_queueTasks.finalize(it->second->getTask());
+			releaseInputs(it->second->getTask());
+			m_servers->recordCompletion(serverId, now - timeSent, it->second->getTask()->getCostHint());
+			heardFrom(*it->second);
 		}
 
 		//
 		// If it came in after its deadline, don't erase from the assigned hash
 		// table because we are going to ignore the result from anything that
 		// showed up late....we want to treat it as if it failed completely.
-		std::chrono::time_point<std::chrono::high_resolution_clock> now = std::chrono::high_resolution_clock::now();
 		if (it->second->getDeadline() >= now || forceRemove)
 		{
-			m_pqHandles.erase(id);
-			m_mapAssigned.erase(id);
+			cancelBackup(id, serverId);
+			untrackAssigned(it);
 			removed = true;
 		}
 	}
@@ -179,249 +351,881 @@ bool TaskRequestQueue::finalizeTask(uint64_t id, bool dagRemove, bool forceRemov
 	// Because there might be dependent tasks that are now freed up, notify the event
 	// to release any dependent tasks.  This should be a notify_all because more than
 	// one task may become freed for work.
-	std::unique_lock<std::mutex> lockTask(m_mutexEventTask);
-	m_eventTask.notify_all();
+	wakeDistributer();
 
 	return removed;
 }
 
+// ------------------------------------------------------------------
+//
+// @details Cancels the task along with everything downstream of it.
+// Returns the number of tasks cancelled.
+//
+// ------------------------------------------------------------------
+std::size_t TaskRequestQueue::cancelTask(uint64_t taskId)
+{
+	std::lock_guard<std::recursive_mutex> lock(m_mutexAssigned);
+
+	return cancelRemoved(m_queueTasks.cancel(taskId));
+}
+
+// ------------------------------------------------------------------
+//
+// @details Cancels every task with the group id, along with everything
+// downstream of them.  Returns the number of tasks cancelled.
+//
+// ------------------------------------------------------------------
+std::size_t TaskRequestQueue::cancelGroup(uint64_t groupId)
+{
+	std::lock_guard<std::recursive_mutex> lock(m_mutexAssigned);
+
+	return cancelRemoved(m_queueTasks.cancelGroup(groupId));
+}
+
 // ------------------------------------------------------------------
 //
 // @details This is the entry point method for the actual work distribution
 // thread.  This method stays running until we are asked to voluntarily terminate.  
-// The thread waits on a signal to check for something in the work queue.  If there
-// is something in the work queue and an available task request, work is sent to
-// the server with an open request.
+// The thread waits on a signal that tasks or credits have come in, or for the next
+// deadline, then matches up as much work with credits as it can.
 //
 // ------------------------------------------------------------------
 void TaskRequestQueue::distribute()
 {
 	while (!m_distributerDone)
 	{
-		auto keepTrying= bool{ true };
-		while (keepTrying)
+		//
+		// Tasks past their deadline are taken right away, whether or not there
+		// is a server to send them to.
+		auto expired = takeExpired();
+		while (expired)
 		{
-			auto distributed = bool{ false };
-			//
-			// Clean out items from the assigned queue that have been finalized
-			compactQueueAssigned();
+			m_retries.push_back(expired.get());
+			expired = takeExpired();
+		}
+		{
+			std::lock_guard<std::mutex> lock(m_mutexRetries);
+			m_retries.insert(m_retries.end(), m_retriesReturned.begin(), m_retriesReturned.end());
+			m_retriesReturned.clear();
+		}
 
-			//
-			// Step 1: Look at the pending result queue.  If the top item is past its deadline, take it as
-			// a new task.
-			if (!isQueueAssignedEmpty())
-			{
-				auto top = getQueueAssignedTop();
-				if (top)
-				{
-					auto now = std::chrono::high_resolution_clock::now();
-					if (top.get()->getDeadline() <= now)
-					{
-						std::cout << "retrying some work..." << std::endl;
-						// clang on MacOS doesn't have to_time_t, so commenting out for now
-						//std::cout << "Deadline : " << std::chrono::high_resolution_clock::to_time_t(top.get()->getDeadline()) << std::endl;
-						//std::cout << "Now      : " << std::chrono::high_resolution_clock::to_time_t(now) << std::endl;
-						std::shared_ptr<Tasks::Task> task = top.get()->getTask();
-						//
-						// This task will be added back into both the assigned queue and the assigned map, so remove it
-						// from both to prevent duplication.
-						popQueueAssigned();
-						finalizeTask(task->getId(), false, true);
-
-						fillRequest(task);
-						distributed = true;
-					}
-				}
-			}
-			//
-			// Step 2: Look at the new work queue and pull something from there if possible
-			if (!distributed)
-			{
-				auto task = m_queueTasks.dequeue();
-				if (task != boost::none)
-				{
-					fillRequest(task.get());
-					distributed = true;
-				}
-				else
-				{
-					keepTrying = false;
-				}
-			}
+		auto keepTrying = bool{ true };
+		while (keepTrying && !m_distributerDone)
+		{
+			keepTrying = matchRequest();
 		}
 		if (!m_distributerDone)
 		{
-			//
-			// Doing a wait_for here because it is possible for there to be only a single outstanding
-			// request and if it fails, we need a way to come out of the wait and check to see if a failure
-			// has occured and deal with it.  The wait time can be very small because this is only ever going
-			// to consume a single CPU core at most.
-			std::unique_lock<std::mutex> lock(m_mutexEventTask);
-			m_eventTask.wait_for(lock, std::chrono::milliseconds(100));
+			waitForWork();
 		}
 	}
 }
 
 // ------------------------------------------------------------------
 //
-// @details This method is used to send a task to a compute server
-// that has indicated (via a task request) that it is available to
-// do some work.
+// @details Matches one server credit with work: a retry first, otherwise
+// the next ready task, otherwise a straggler worth backing up.  Returns
+// false once there is nothing more to match.  Nothing is taken from the
+// DAG unless there is a credit for it, without one the ready tasks stay
+// in the DAG, and the distributer goes back to waiting.
 //
 // ------------------------------------------------------------------
-void TaskRequestQueue::fillRequest(std::shared_ptr<Tasks::Task> task)
+bool TaskRequestQueue::matchRequest()
 {
-	auto removed = m_servers->removeDisconnected();
+	if (!haveCredits())
+	{
+		m_speculateAt = boost::none;
+		return false;
+	}
+
 	//
-	// This is slow, but has to be done.  If any servers where removed, have to go through the
-	// queue and remove any requests from those servers.  If those requests aren't removed it
-	// causes a real performance delay because attempts to match requests from those servers
-	// are still performed.
-	if (!removed.empty())
+	// A credit can still be gone by the time it is taken, when its server
+	// was just removed, in which case the credits are looked at again.
+	if (!m_retries.empty())
 	{
-		std::lock_guard<std::mutex> lockRequest(m_mutexRequest);
-		std::queue<ServerID_t> validRequests;
-		while (!m_queueRequest.empty())
+		if (fillRequest(m_retries.front(), true))
 		{
-			auto serverId = m_queueRequest.front();
-			m_queueRequest.pop();
-			if (removed.find(serverId) == removed.end())
-			{
-				validRequests.push(serverId);
-			}
+			m_retries.pop_front();
 		}
+		return true;
+	}
+
+	auto task = nextReady();
+	if (task == boost::none)
+	{
+		//
+		// Nothing left to go out, see if any stragglers are worth backing up
+		return speculate();
+	}
+	if (!fillRequest(task.get(), false))
+	{
+		m_carried = task;
+	}
+
+	return true;
+}
+
+// ------------------------------------------------------------------
+//
+// @details Returns true if any server has a credit left.  Credits are
+// asked for before looking, so any that come in after the look wake
+// the distributer.
+//
+// ------------------------------------------------------------------
+bool TaskRequestQueue::haveCredits()
+{
+	m_wantCredits = true;
+
+	std::lock_guard<std::mutex> lock(m_mutexRequest);
+	auto have = !m_queueRequest.empty();
+	m_wantCredits = !have;
+
+	return have;
+}
 
-		m_queueRequest = std::move(validRequests);
+// ------------------------------------------------------------------
+//
+// @details Blocks the distributer until it has been signaled there is
+// something new to do, or until the next assigned task deadline comes
+// due.  With nothing assigned, there is no deadline to wake up for.
+//
+// m_wakeAt is cleared before the next deadline is looked up, so a
+// deadline scheduled while it is being looked up still signals.  The
+// assigned mutex is never taken while holding the event mutex.
+//
+// ------------------------------------------------------------------
+void TaskRequestQueue::waitForWork()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutexEventTask);
+		if (m_taskSignaled)
+		{
+			m_taskSignaled = false;
+			return;
+		}
+		m_wakeAt = std::chrono::high_resolution_clock::time_point::max();
 	}
 
+	boost::optional<std::chrono::high_resolution_clock::time_point> next;
+	{
+		std::lock_guard<std::recursive_mutex> lock(m_mutexAssigned);
+		if (!m_deadlines.empty())
+		{
+			next = m_deadlines.topPriority();
+		}
+	}
+	if (m_speculateAt && (!next || m_speculateAt.get() < next.get()))
+	{
+		next = m_speculateAt;
+	}
+
+	std::unique_lock<std::mutex> lock(m_mutexEventTask);
+	auto signaled = [this]() { return m_taskSignaled || m_distributerDone; };
+	if (next)
+	{
+		m_wakeAt = next.get();
+		m_eventTask.wait_until(lock, next.get(), signaled);
+	}
+	else
+	{
+		m_eventTask.wait(lock, signaled);
+	}
+	m_taskSignaled = false;
+	m_wakeAt = std::chrono::high_resolution_clock::time_point::max();
+}
+
+// ------------------------------------------------------------------
+//
+// @details Signals the distributer there is something new to do.
+//
+// ------------------------------------------------------------------
+void TaskRequestQueue::wakeDistributer()
+{
+	std::lock_guard<std::mutex> lock(m_mutexEventTask);
+	m_taskSignaled = true;
+	m_eventTask.notify_all();
+}
+
+// ------------------------------------------------------------------
+//
+// @details Signals the distributer only if the new deadline is ahead
+// of the one it is already waiting for.
+//
+// ------------------------------------------------------------------
+void TaskRequestQueue::wakeDistributer(std::chrono::high_resolution_clock::time_point deadline)
+{
+	std::lock_guard<std::mutex> lock(m_mutexEventTask);
+	if (deadline < m_wakeAt)
+	{
+		m_taskSignaled = true;
+		m_eventTask.notify_all();
+	}
+}
+
+// ------------------------------------------------------------------
+//
+// @details This method is used to send a task to a compute server
+// that has indicated (via a task request) that it is available to
+// do some work.  A retry is a task that was previously sent, but
+// for which a result never came back.
+//
+// Other ready tasks are sent along with a new task, as many as the server
+// has credits for.  Retries are always sent by themselves.  Returns false,
+// without sending anything, if no server has a credit left.
+//
+// ------------------------------------------------------------------
+bool TaskRequestQueue::fillRequest(std::shared_ptr<Tasks::Task> task, bool retry)
+{
+	//
+	// A task that takes inputs would like to go to the server already holding them
+	auto preferred = getPreferredServer(task);
+	auto critical = task->getCostHint() > 1 || m_queueTasks.isCritical(task);
+
 	auto serverId = ServerID_t{ 0 };
-	auto done = bool{ false };
-	while (!done)
 	{
 		//
-		// Try to get a matching request
+		// Take a credit from a server, which goes to the back of the line if
+		// it has more left
+		std::lock_guard<std::mutex> lockRequest(m_mutexRequest);
+		if (m_queueRequest.empty())
+		{
+			return false;
+		}
+		auto request = critical ? getFastestRequest() : m_queueRequest.begin();
+		if (preferred)
 		{
-			std::lock_guard<std::mutex> lockRequest(m_mutexRequest);
-			if (!m_queueRequest.empty())
+			auto match = std::find(m_queueRequest.begin(), m_queueRequest.end(), preferred.get());
+			if (match != m_queueRequest.end())
 			{
-				serverId = m_queueRequest.front();
-				m_queueRequest.pop();
-				done = true;
+				request = match;
 			}
 		}
-		if (!done)
+		serverId = *request;
+		m_queueRequest.erase(request);
+		if (--m_credits[serverId] > 0)
 		{
-			std::unique_lock<std::mutex> lock(m_mutexEventRequest);
-			m_eventRequest.wait(lock);
+			m_queueRequest.push_back(serverId);
 		}
+		else
+		{
+			m_credits.erase(serverId);
+		}
+	}
+
+	std::vector<std::shared_ptr<Tasks::Task>> tasks(1, task);
+	if (!retry)
+	{
+		fillBatch(serverId, tasks);
 	}
 
 	m_ioService->post(
-		[this, serverId, task]()
+		[this, serverId, tasks, retry]()
 	{
 		//
 		// Waiting to add it to the assigned queue until it actually gets processed by the io_service
 		// thread, thinking that gives a more accurate time through the system.  Although, it can
 		// be argued the correct time is when it is posted, because the time spent waiting in the
 		// io_service queue is real time that counts against the deadline.
+		std::vector<std::shared_ptr<Tasks::Task>> sending;
+		auto deadline = std::chrono::high_resolution_clock::time_point::max();
+		auto returned = uint32_t{ 0 };
 		{
 			std::lock_guard<std::recursive_mutex> lock(m_mutexAssigned);
-			auto assigned = std::make_shared<AssignedTask>(task);
-			auto handle = m_queueAssigned.push(assigned);
-			m_pqHandles[task->getId()] = handle;
-			m_mapAssigned[task->getId()] = assigned;
+			//
+			// The server may have gone away since its credits were taken, the tasks
+			// go back to be sent somewhere else.  A retry goes back with the retries,
+			// so its inputs are still sent along with it.
+			if (!m_servers->exists(serverId))
+			{
+				if (retry)
+				{
+					std::lock_guard<std::mutex> lockRetries(m_mutexRetries);
+					m_retriesReturned.insert(m_retriesReturned.end(), tasks.begin(), tasks.end());
+				}
+				else
+				{
+					for (const auto& task : tasks)
+					{
+						m_queueTasks.requeue(task);
+					}
+				}
+				wakeDistributer();
+				return;
+			}
+			for (const auto& task : tasks)
+			{
+				//
+				// The task may have been cancelled while waiting for a request, in which
+				// case the credit goes back to the server for the next task, once the
+				// lock is released.
+				if (!m_queueTasks.contains(task->getId()))
+				{
+					returned++;
+					continue;
+				}
+				auto assigned = makeAssigned(task, serverId);
+				trackAssigned(assigned);
+				deadline = std::min(deadline, assigned->getDeadline());
+				sending.push_back(task);
+			}
+		}
+		if (returned > 0)
+		{
+			enqueueRequest(serverId, returned);
 		}
+		if (sending.empty())
+		{
+			return;
+		}
+		wakeDistributer(deadline);
 
 		//std::chrono::time_point<std::chrono::high_resolution_clock, std::chrono::nanoseconds> now = std::chrono::high_resolution_clock::now();
 		//std::cout << "Sending Task" << std::fixed << std::setprecision(10) << (now.time_since_epoch().count() / 1000000000.0) << std::endl;
 
-		task->send(m_servers->get(serverId)->socket, *m_servers->get(serverId)->strand);
+		sendTasks(serverId, sending, retry);
 	});
+
+	return true;
 }
 
 // ------------------------------------------------------------------
 //
-// @details Remove things from the queue that are not found in the 
-// assigned hash table.  Items found in the assigned queue and not 
-// in the assigned hash table are those that have a result returned
-// and finalized.  Therefore, we want to ignore them.
+// @details Sends the tasks, along with their dataflow messages, to the
+// server.  More than one task goes out as a single batch.
 //
 // ------------------------------------------------------------------
-void TaskRequestQueue::compactQueueAssigned()
+void TaskRequestQueue::sendTasks(ServerID_t serverId, const std::vector<std::shared_ptr<Tasks::Task>>& tasks, bool retry)
 {
-	std::lock_guard<std::recursive_mutex> lock(m_mutexAssigned);
+	auto server = m_servers->get(serverId);
+	if (!server)
+	{
+		return;
+	}
+
+	if (tasks.size() == 1)
+	{
+		auto dataflow = getDataflow(tasks.front(), serverId, retry);
+		if (dataflow)
+		{
+			Messages::send(dataflow, server->socket, *server->strand);
+		}
+		tasks.front()->send(server->socket, *server->strand);
+	}
+	else
+	{
+		//
+		// The dataflow for each task goes in the batch just ahead of it
+		auto batch = std::make_shared<Messages::TaskBatch>();
+		for (const auto& task : tasks)
+		{
+			auto dataflow = getDataflow(task, serverId, retry);
+			if (dataflow)
+			{
+				batch->add(*dataflow);
+			}
+			task->addTo(*batch);
+		}
+		Messages::send(batch, server->socket, *server->strand);
+	}
+}
+
+// ------------------------------------------------------------------
+//
+// @details Called by the distributer when there is nothing ready to go
+// out.  If a server has credits left over, the assigned task furthest
+// behind the time the fastest of those servers is expected to take is
+// sent to it as a backup, if it is far enough behind.  Only the oldest
+// task without a backup on each of the other servers is looked at, it
+// stands in for the rest of the work on that server.  Returns true if a
+// backup was sent.  Otherwise, notes when the next task will be far
+// enough behind, or that credits are wanted, so the distributer is woken
+// up to look again.
+//
+// ------------------------------------------------------------------
+bool TaskRequestQueue::speculate()
+{
+	m_speculateAt = boost::none;
+	m_wantCredits = false;
 
-	auto done = bool{ false };
-	while (!isQueueAssignedEmpty() && !done)
+	auto serverId = ServerID_t{ 0 };
+	auto serviceTime = 0.0;
+	{
+		std::lock_guard<std::mutex> lock(m_mutexRequest);
+		if (!m_queueRequest.empty())
+		{
+			serverId = *getFastestRequest();
+			serviceTime = m_servers->getServiceTime(serverId);
+		}
+	}
+
+	std::shared_ptr<Tasks::Task> straggler;
 	{
-		auto top = getQueueAssignedTop();
-		if (top)
+		std::lock_guard<std::recursive_mutex> lock(m_mutexAssigned);
+		if (m_mapAssigned.empty())
+		{
+			return false;
+		}
+		if (serviceTime == 0)
 		{
-			if (!mapAssignedContains(top.get()->getTask()->getId()))
+			//
+			// Either there are no idle servers, or the idle one hasn't been
+			// measured yet.  Either way, look again when credits come in.
+			m_wantCredits = true;
+			return false;
+		}
+
+		auto now = std::chrono::high_resolution_clock::now();
+		auto worst = SPECULATE_SLOWDOWN;
+		for (const auto& index : m_assignedByServer)
+		{
+			if (index.first == serverId)
+			{
+				continue;
+			}
+			auto oldest = std::find_if(index.second.begin(), index.second.end(),
+				[this](const std::pair<std::chrono::high_resolution_clock::time_point, uint64_t>& entry)
+				{
+					return m_backups.find(entry.second) == m_backups.end();
+				});
+			if (oldest == index.second.end())
 			{
-				popQueueAssigned();
+				continue;
+			}
+			auto task = m_mapAssigned[oldest->second]->getTask();
+			auto expected = serviceTime * std::max(task->getCostHint(), 1u);
+			auto elapsed = std::chrono::duration<double>(now - oldest->first).count();
+			if (elapsed / expected > worst)
+			{
+				worst = elapsed / expected;
+				straggler = task;
 			}
 			else
 			{
-				done = true;
+				auto due = oldest->first + std::chrono::duration_cast<std::chrono::high_resolution_clock::duration>(std::chrono::duration<double>(SPECULATE_SLOWDOWN * expected));
+				if (!m_speculateAt || due < m_speculateAt.get())
+				{
+					m_speculateAt = due;
+				}
 			}
 		}
+		if (!straggler)
+		{
+			return false;
+		}
+		if (takeCredits(serverId, 1) == 0)
+		{
+			m_wantCredits = true;
+			return false;
+		}
+		m_backups[straggler->getId()] = Backup{ serverId, std::chrono::high_resolution_clock::now() };
+	}
+
+	m_ioService->post(
+		[this, serverId, straggler]()
+	{
+		auto finished = bool{ false };
+		{
+			std::lock_guard<std::recursive_mutex> lock(m_mutexAssigned);
+			//
+			// The first copy may have finished while this was waiting to go out
+			finished = (m_mapAssigned.find(straggler->getId()) == m_mapAssigned.end());
+		}
+		if (finished)
+		{
+			enqueueRequest(serverId);
+			return;
+		}
+		sendTasks(serverId, std::vector<std::shared_ptr<Tasks::Task>>(1, straggler), false);
+	});
+
+	return true;
+}
+
+// ------------------------------------------------------------------
+//
+// @details Once the result of an assigned task is in, any backup copy of
+// it is no longer wanted.  Whichever of the two servers didn't return the
+// result is told to stop.  Must be called while holding m_mutexAssigned.
+//
+// ------------------------------------------------------------------
+void TaskRequestQueue::cancelBackup(uint64_t id, ServerID_t winnerId)
+{
+	auto backup = m_backups.find(id);
+	if (backup != m_backups.end())
+	{
+		auto loserId = (backup->second.server == winnerId) ? m_mapAssigned[id]->getServerId() : backup->second.server;
+		sendCancel(id, loserId);
+		m_backups.erase(backup);
 	}
 }
 
 // ------------------------------------------------------------------
 //
-// @details Returns true if the assigned work queue is empty, false
-// otherwise.
+// @details Tells the server to stop working on the task.
 //
 // ------------------------------------------------------------------
-bool TaskRequestQueue::isQueueAssignedEmpty()
+void TaskRequestQueue::sendCancel(uint64_t id, ServerID_t serverId)
 {
-	std::lock_guard<std::recursive_mutex> lock(m_mutexAssigned);
+	auto server = m_servers->get(serverId);
+	if (server)
+	{
+		auto status = std::make_shared<Messages::TaskStatus>(id, PBMessages::TaskStatus_Status_Cancelled);
+		Messages::send(status, server->socket, *server->strand);
+	}
+}
+
+// ------------------------------------------------------------------
+//
+// @details Returns the request from the server with the lowest smoothed
+// service time.  A server that hasn't returned any results yet counts as
+// the fastest, so it gets measured.  Must be called while holding
+// m_mutexRequest, with at least one request in the queue.
+//
+// ------------------------------------------------------------------
+std::deque<ServerID_t>::iterator TaskRequestQueue::getFastestRequest()
+{
+	auto fastest = m_queueRequest.begin();
+	auto fastestTime = m_servers->getServiceTime(*fastest);
+	for (auto request = std::next(fastest); request != m_queueRequest.end() && fastestTime > 0; ++request)
+	{
+		auto time = m_servers->getServiceTime(*request);
+		if (time < fastestTime)
+		{
+			fastest = request;
+			fastestTime = time;
+		}
+	}
 
-	return m_queueAssigned.empty();
+	return fastest;
 }
 
 // ------------------------------------------------------------------
 //
-// @details Removes the top item from the assigned work queue.
+// @details Adds more ready tasks for the server, using up the credits it
+// has left.  Credits are already the number of tasks the server is ready
+// to start, so sending that many at once doesn't hold any of them up.  A
+// task that would rather go to a different server, because its inputs
+// are there, ends the batch and is held over for the next request.
+// Credits that aren't used go back to the server.
 //
 // ------------------------------------------------------------------
-void TaskRequestQueue::popQueueAssigned()
+void TaskRequestQueue::fillBatch(ServerID_t serverId, std::vector<std::shared_ptr<Tasks::Task>>& tasks)
 {
-	std::lock_guard<std::recursive_mutex> lock(m_mutexAssigned);
+	auto credits = takeCredits(serverId, TASK_BATCH_MOST - 1);
+	while (credits > 0)
+	{
+		auto task = nextReady();
+		if (!task)
+		{
+			break;
+		}
+		auto preferred = getPreferredServer(task.get());
+		if (preferred && preferred.get() != serverId)
+		{
+			m_carried = task;
+			break;
+		}
+		tasks.push_back(task.get());
+		credits--;
+	}
 
-	m_queueAssigned.pop();
+	enqueueRequest(serverId, credits);
 }
 
 // ------------------------------------------------------------------
 //
-// @details Checks to see if a task id exists in the assigned hash table.
+// @details Takes up to the most credits the server has left, returning
+// the number taken.
 //
 // ------------------------------------------------------------------
-bool TaskRequestQueue::mapAssignedContains(uint64_t id)
+uint32_t TaskRequestQueue::takeCredits(ServerID_t serverId, uint32_t most)
 {
-	std::lock_guard<std::recursive_mutex> lock(m_mutexAssigned);
+	std::lock_guard<std::mutex> lock(m_mutexRequest);
 
-	return !(m_mapAssigned.find(id) == m_mapAssigned.end());
+	auto available = m_credits.find(serverId);
+	if (available == m_credits.end())
+	{
+		return 0;
+	}
+
+	auto taken = std::min(available->second, most);
+	available->second -= taken;
+	if (available->second == 0)
+	{
+		m_credits.erase(available);
+		m_queueRequest.erase(std::find(m_queueRequest.begin(), m_queueRequest.end(), serverId));
+	}
+
+	return taken;
 }
 
 // ------------------------------------------------------------------
 //
-// @details Returns the top item from the assigned queue.  The item
-// is not removed from the queue.  If there are no items in the queue
-// the return value is a nullptr.
+// @details Returns the task held over from the last batch, if there is
+// one, otherwise the next ready task from the DAG.
 //
 // ------------------------------------------------------------------
-boost::optional<std::shared_ptr<AssignedTask>> TaskRequestQueue::getQueueAssignedTop()
+boost::optional<std::shared_ptr<Tasks::Task>> TaskRequestQueue::nextReady()
+{
+	if (m_carried)
+	{
+		auto task = m_carried;
+		m_carried = boost::none;
+		return task;
+	}
+
+	return m_queueTasks.dequeue();
+}
+
+// ------------------------------------------------------------------
+//
+// @details Returns the server holding the most input data for the task,
+// if any of the inputs are cached on a server that is still connected.
+//
+// ------------------------------------------------------------------
+boost::optional<ServerID_t> TaskRequestQueue::getPreferredServer(std::shared_ptr<Tasks::Task> task)
+{
+	boost::optional<ServerID_t> preferred;
+	if (task->getInputs().empty())
+	{
+		return preferred;
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutexDataflow);
+
+	std::unordered_map<ServerID_t, std::size_t> bytes;
+	for (const auto& input : task->getInputs())
+	{
+		auto source = m_dataflow.find(input.sourceId);
+		if (source != m_dataflow.end() && source->second.produced)
+		{
+			bytes[source->second.server] += source->second.payload->size();
+		}
+	}
+
+	auto most = std::size_t{ 0 };
+	for (const auto& server : bytes)
+	{
+		if ((!preferred || server.second > most) && m_servers->exists(server.first))
+		{
+			preferred = server.first;
+			most = server.second;
+		}
+	}
+
+	return preferred;
+}
+
+// ------------------------------------------------------------------
+//
+// @details If the task takes part in dataflow, or isn't of normal
+// priority, returns the dataflow message that goes ahead of the task,
+// otherwise nullptr.  Inputs the server
+// should already have cached are sent without their payload.  On a
+// retry, every payload is sent because the reason for the retry may
+// well be the server no longer has them.
+//
+// ------------------------------------------------------------------
+std::shared_ptr<Messages::TaskDataflow> TaskRequestQueue::getDataflow(std::shared_ptr<Tasks::Task> task, ServerID_t serverId, bool retry)
+{
+	if (!task->getRetainResult() && task->getInputs().empty() && task->getPriority() == Tasks::Priority::Normal)
+	{
+		return nullptr;
+	}
+
+	auto message = std::make_shared<Messages::TaskDataflow>(task->getId(), task->getRetainResult(), static_cast<uint32_t>(task->getPriority()));
+	{
+		std::lock_guard<std::mutex> lock(m_mutexDataflow);
+
+		for (const auto& input : task->getInputs())
+		{
+			auto source = m_dataflow.find(input.sourceId);
+			assert(source != m_dataflow.end() && source->second.produced);
+
+			auto cached = !retry && source->second.server == serverId;
+			message->addInput(input.sourceId, cached ? nullptr : source->second.payload);
+		}
+	}
+
+	return message;
+}
+
+// ------------------------------------------------------------------
+//
+// @details Once a task with inputs has finished, those inputs are
+// no longer needed by it.  When the last dependent of a source has
+// finished, the result of the source is dropped.
+//
+// ------------------------------------------------------------------
+void TaskRequestQueue::releaseInputs(std::shared_ptr<Tasks::Task> task)
+{
+	if (task->getInputs().empty())
+	{
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutexDataflow);
+
+	for (const auto& input : task->getInputs())
+	{
+		auto source = m_dataflow.find(input.sourceId);
+		if (source != m_dataflow.end() && --source->second.consumers == 0)
+		{
+			m_dataflow.erase(source);
+		}
+	}
+}
+
+// ------------------------------------------------------------------
+//
+// @details Finishes up tasks that have been removed from the DAG by a
+// cancel.  Any that are assigned are taken out of the assigned tracking,
+// so a result that still shows up is ignored, and the server working on
+// it is told to stop.  Must be called while holding m_mutexAssigned.
+//
+// ------------------------------------------------------------------
+std::size_t TaskRequestQueue::cancelRemoved(const std::vector<std::shared_ptr<Tasks::Task>>& removed)
+{
+	for (const auto& task : removed)
+	{
+		releaseInputs(task);
+
+		auto assigned = m_mapAssigned.find(task->getId());
+		if (assigned != m_mapAssigned.end())
+		{
+			sendCancel(task->getId(), assigned->second->getServerId());
+			auto backup = m_backups.find(task->getId());
+			if (backup != m_backups.end())
+			{
+				sendCancel(task->getId(), backup->second.server);
+				m_backups.erase(backup);
+			}
+			untrackAssigned(assigned);
+		}
+	}
+
+	return removed.size();
+}
+
+// ------------------------------------------------------------------
+//
+// @details Returns an assigned task that is past its deadline, taking it
+// out of the assigned tracking so it can be sent out again.  A task with
+// a backup copy running isn't sent out again, instead the backup takes the
+// place of the first copy, with a deadline of its own.
+//
+// ------------------------------------------------------------------
+boost::optional<std::shared_ptr<Tasks::Task>> TaskRequestQueue::takeExpired()
 {
-	boost::optional<std::shared_ptr<AssignedTask>> result;	// defaults to uninitialized
 	std::lock_guard<std::recursive_mutex> lock(m_mutexAssigned);
 
-	if (!m_queueAssigned.empty())
+	auto now = std::chrono::high_resolution_clock::now();
+	while (!m_deadlines.empty() && m_deadlines.topPriority() <= now)
 	{
-		result = m_queueAssigned.top();
+		auto id = m_deadlines.topKey();
+		auto assigned = m_mapAssigned.find(id);
+		auto task = assigned->second->getTask();
+		if (!assigned->second->hasFaulted())
+		{
+			m_estimator.backoff(assigned->second->getServerId(), typeid(*task));
+		}
+		auto backup = m_backups.find(id);
+		if (backup != m_backups.end())
+		{
+			trackAssigned(makeAssigned(task, backup->second));
+			m_backups.erase(backup);
+			continue;
+		}
+		untrackAssigned(assigned);
+		return task;
 	}
 
-	return result;
+	return boost::none;
+}
+
+// ------------------------------------------------------------------
+//
+// @details Tracks the task as assigned to the server, with a deadline
+// from the timeout learned for the server and the type of task.
+//
+// ------------------------------------------------------------------
+std::shared_ptr<AssignedTask> TaskRequestQueue::makeAssigned(std::shared_ptr<Tasks::Task> task, ServerID_t serverId)
+{
+	return std::make_shared<AssignedTask>(task, serverId, m_estimator.getTimeout(serverId, typeid(*task)));
+}
+
+// ------------------------------------------------------------------
+//
+// @details Tracks the backup copy as the assignment of the task, from
+// when the backup was sent, with a fresh deadline.
+//
+// ------------------------------------------------------------------
+std::shared_ptr<AssignedTask> TaskRequestQueue::makeAssigned(std::shared_ptr<Tasks::Task> task, const Backup& backup)
+{
+	return std::make_shared<AssignedTask>(task, backup.server, m_estimator.getTimeout(backup.server, typeid(*task)), backup.timeSent);
+}
+
+// ------------------------------------------------------------------
+//
+// @details Learns from the time since last hearing about the task, a
+// status or its result has just come in.
+//
+// ------------------------------------------------------------------
+void TaskRequestQueue::heardFrom(AssignedTask& assigned)
+{
+	auto interval = std::chrono::high_resolution_clock::now() - assigned.getLastHeard();
+	m_estimator.addSample(assigned.getServerId(), typeid(*assigned.getTask()), interval);
+}
+
+// ------------------------------------------------------------------
+//
+// @details Adds the assigned task to the tracking, replacing any earlier
+// assignment of the same task.  Must be called while holding
+// m_mutexAssigned.
+//
+// ------------------------------------------------------------------
+void TaskRequestQueue::trackAssigned(std::shared_ptr<AssignedTask> assigned)
+{
+	auto id = assigned->getTask()->getId();
+	auto existing = m_mapAssigned.find(id);
+	if (existing != m_mapAssigned.end())
+	{
+		unindexAssigned(*existing->second);
+	}
+
+	m_mapAssigned[id] = assigned;
+	m_assignedByServer[assigned->getServerId()].emplace(assigned->getTimeAssigned(), id);
+	m_deadlines.set(id, assigned->getDeadline());
+}
+
+// ------------------------------------------------------------------
+//
+// @details Removes the assigned task from all of the tracking.  Must be
+// called while holding m_mutexAssigned.
+//
+// ------------------------------------------------------------------
+void TaskRequestQueue::untrackAssigned(std::unordered_map<uint64_t, std::shared_ptr<AssignedTask>>::iterator assigned)
+{
+	unindexAssigned(*assigned->second);
+	m_deadlines.erase(assigned->first);
+	m_mapAssigned.erase(assigned);
+}
+
+// ------------------------------------------------------------------
+//
+// @details Removes the task from the index of tasks assigned to the
+// server.
+//
+// ------------------------------------------------------------------
+void TaskRequestQueue::unindexAssigned(AssignedTask& assigned)
+{
+	auto index = m_assignedByServer.find(assigned.getServerId());
+	if (index != m_assignedByServer.end())
+	{
+		index->second.erase(std::make_pair(assigned.getTimeAssigned(), assigned.getTask()->getId()));
+		if (index->second.empty())
+		{
+			m_assignedByServer.erase(index);
+		}
+	}
 }
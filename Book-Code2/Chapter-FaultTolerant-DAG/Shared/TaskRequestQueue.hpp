@@ -2,23 +2,26 @@
 #define _TASKREQUESTQUEUE_HPP_
 
 #include "AssignedTask.hpp"
+#include "DeadlineEstimator.hpp"
 #include "ServerSet.hpp"
+#include "Shared/Messages/Message.hpp"
+#include "Shared/Messages/TaskDataflow.hpp"
 #include "Shared/Tasks/Task.hpp"
 #include "Shared/Threading/ConcurrentDAG.hpp"
+#include "Shared/Threading/IndexedHeap.hpp"
 
+#include <chrono>
+#include <atomic>
 #include <condition_variable>
+#include <deque>
 #include <memory>
 #include <mutex>
-#include <queue>
+#include <set>
+#include <string>
 #include <thread>
 #include <unordered_map>
 #include <vector>
 
-#pragma warning(push)
-#pragma warning(disable : 4390)
-#include <boost/heap/binomial_heap.hpp>
-#pragma warning(pop)
-
 // ------------------------------------------------------------------
 //
 // @details The TaskRequestQueue is used to collect and distribute work
@@ -30,6 +33,49 @@
 // items are distributed to compute servers by filling any available
 // work requeusts.
 //
+// A request carries some number of credits, one for each task the server
+// is ready to take on.  The credits are counted per server, and servers
+// with credits left are taken in turn, except for critical tasks, those
+// that have a cost hint above the default or that the DAG finds are on
+// its critical path.  These go to whichever server with credits has been
+// returning results the fastest, as measured by the ServerSet.  When a
+// server has more than one credit, several ready tasks may go to it
+// together in a single batch.
+//
+// Edges added with .enqueueDataflow also carry the result of the source
+// task to the dependent.  The result stays cached on the compute server
+// that produced it, and the dependent is sent to that server whenever it
+// has a request open, in which case the result doesn't need to be sent
+// back down from the client.
+//
+// Tasks can be cancelled, either one at a time or by group id.  Cancelling
+// a task also cancels every task downstream of it in the DAG.  Cancelled
+// tasks that are already assigned to a compute server are sent a cancel
+// status so the server can stop working on them.
+//
+// The tasks assigned to each server are indexed, oldest assignment first.
+// When the connection to a server is lost its work goes straight back to
+// the DAG, and looking for stragglers only needs the oldest task on each
+// server.
+//
+// At the tail of a stage, when nothing is ready to go and servers have
+// credits left over, the assigned task that is furthest behind what the
+// fastest idle server would take is sent to that server as well.  The
+// first result to come back is used and the other copy is cancelled.
+//
+// How long to wait to hear about an assigned task is learned for each
+// server and type of task, see DeadlineEstimator.  The deadlines of
+// assigned tasks are kept in an indexed 4-ary heap, so a deadline can be
+// moved or dropped by task id without leaving anything behind.  The
+// distributer sleeps until the next deadline comes due, or until it is
+// signaled that there is something new to do, rather than polling.
+//
+// The distributer never waits on a server to ask for work.  Ready tasks
+// stay in the DAG, and expired tasks wait with the retries, until there
+// is a credit to send them with.  Whenever tasks or credits come in, the
+// distributer is woken to match the two up, so deadlines and new work
+// are still looked after while every server is busy.
+//
 // ------------------------------------------------------------------
 class TaskRequestQueue
 {
@@ -38,15 +84,25 @@ public:
 
 	void initialize(boost::asio::io_service* ioService, ServerSet* servers);
 	void terminate();
-	void enqueueRequest(ServerID_t request);
+	void enqueueRequest(ServerID_t request, uint32_t credits = 1);
+	void removeServer(ServerID_t serverId);
+	void setRanking(DAGRanking ranking)		{ m_queueTasks.setRanking(ranking); }
 
 	void beginGroup()		{ m_queueTasks.beginGroup(); }
 	void endGroup()			{ m_queueTasks.endGroup(); }
 	void enqueueTask(std::shared_ptr<Tasks::Task> source);
 	void enqueueTask(std::shared_ptr<Tasks::Task> source, std::shared_ptr<Tasks::Task> dependent);
+	void enqueueGraph(const GraphBuilder<std::shared_ptr<Tasks::Task>>& graph);
+	void enqueueDataflow(std::shared_ptr<Tasks::Task> source, std::shared_ptr<Tasks::Task> dependent);
 
 	void touchTask(uint64_t taskId);
-	bool finalizeTask(uint64_t id, bool dagRemove, bool forceRemove);
+	void failTask(uint64_t taskId);
+	void recordResult(uint64_t taskId, ServerID_t serverId, const Messages::Message& result);
+	bool finalizeTask(uint64_t id, ServerID_t serverId, bool dagRemove, bool forceRemove);
+	std::size_t cancelTask(uint64_t taskId);
+	std::size_t cancelGroup(uint64_t groupId);
+
+	std::vector<DeadlineEstimator::Estimate> getDeadlineEstimates()	{ return m_estimator.getEstimates(); }
 
 protected:
 	TaskRequestQueue();
@@ -56,31 +112,82 @@ private:
 	boost::asio::io_service* m_ioService;
 	ServerSet* m_servers;
 
-	std::queue<ServerID_t> m_queueRequest;
+	std::deque<ServerID_t> m_queueRequest;						// Servers with credits, in turn order
+	std::unordered_map<ServerID_t, uint32_t> m_credits;
 	std::mutex m_mutexRequest;
-	std::condition_variable m_eventRequest;
-	std::mutex m_mutexEventRequest;
 
 	ConcurrentDAG<std::shared_ptr<Tasks::Task>> m_queueTasks;
 	std::condition_variable m_eventTask;
 	std::mutex m_mutexEventTask;
+	bool m_taskSignaled;										// Guarded by m_mutexEventTask
+	std::chrono::high_resolution_clock::time_point m_wakeAt;	// Guarded by m_mutexEventTask
 
-	typedef boost::heap::binomial_heap<std::shared_ptr<AssignedTask>, boost::heap::compare<AssignedTaskCompare>> PriorityQueue;
-	PriorityQueue m_queueAssigned;
 	std::unordered_map<uint64_t, std::shared_ptr<AssignedTask>> m_mapAssigned;
-	std::unordered_map<uint64_t, PriorityQueue::handle_type> m_pqHandles;
+	std::unordered_map<ServerID_t, std::set<std::pair<std::chrono::high_resolution_clock::time_point, uint64_t>>> m_assignedByServer;	// Ids in m_mapAssigned, by server, oldest assignment first
+	IndexedHeap<uint64_t, std::chrono::high_resolution_clock::time_point> m_deadlines;
+	DeadlineEstimator m_estimator;
+	boost::optional<std::shared_ptr<Tasks::Task>> m_carried;	// Ready task held over from a batch, only used by the distributer
+	std::deque<std::shared_ptr<Tasks::Task>> m_retries;			// Expired tasks waiting on a credit, only used by the distributer
+	std::deque<std::shared_ptr<Tasks::Task>> m_retriesReturned;	// Retries whose server went away before they were sent
+	std::mutex m_mutexRetries;									// Guards m_retriesReturned
+	struct Backup
+	{
+		ServerID_t server;										// Server running a backup copy of an assigned task
+		std::chrono::high_resolution_clock::time_point timeSent;
+	};
+	std::unordered_map<uint64_t, Backup> m_backups;
+	boost::optional<std::chrono::high_resolution_clock::time_point> m_speculateAt;	// Only used by the distributer
+	std::atomic<bool> m_wantCredits;
 	std::recursive_mutex m_mutexAssigned;
 
+	//
+	// Results of dataflow source tasks, kept until every dependent has finished
+	struct DataflowSource
+	{
+		DataflowSource() :
+			produced(false),
+			server(0),
+			consumers(0)
+		{
+		}
+
+		bool produced;									// A result has been received
+		ServerID_t server;								// Compute server that produced (and cached) the result
+		std::shared_ptr<const std::string> payload;		// Serialized result message
+		uint32_t consumers;								// Dependents that have not yet finished
+	};
+	std::unordered_map<uint64_t, DataflowSource> m_dataflow;
+	std::mutex m_mutexDataflow;
+
 	std::shared_ptr<std::thread> m_distributer;
 	bool m_distributerDone;
 
 	void distribute();
-	void fillRequest(std::shared_ptr<Tasks::Task> task);
-	void compactQueueAssigned();
-	bool isQueueAssignedEmpty();
-	void popQueueAssigned();
-	bool mapAssignedContains(uint64_t id);
-	boost::optional<std::shared_ptr<AssignedTask>> getQueueAssignedTop();
+	void waitForWork();
+	void wakeDistributer();
+	void wakeDistributer(std::chrono::high_resolution_clock::time_point deadline);
+	bool matchRequest();
+	bool haveCredits();
+	bool fillRequest(std::shared_ptr<Tasks::Task> task, bool retry);
+	void fillBatch(ServerID_t serverId, std::vector<std::shared_ptr<Tasks::Task>>& tasks);
+	uint32_t takeCredits(ServerID_t serverId, uint32_t most);
+	boost::optional<std::shared_ptr<Tasks::Task>> nextReady();
+	void sendTasks(ServerID_t serverId, const std::vector<std::shared_ptr<Tasks::Task>>& tasks, bool retry);
+	bool speculate();
+	void cancelBackup(uint64_t id, ServerID_t winnerId);
+	void sendCancel(uint64_t id, ServerID_t serverId);
+	std::shared_ptr<AssignedTask> makeAssigned(std::shared_ptr<Tasks::Task> task, ServerID_t serverId);
+	std::shared_ptr<AssignedTask> makeAssigned(std::shared_ptr<Tasks::Task> task, const Backup& backup);
+	void heardFrom(AssignedTask& assigned);
+	void trackAssigned(std::shared_ptr<AssignedTask> assigned);
+	void untrackAssigned(std::unordered_map<uint64_t, std::shared_ptr<AssignedTask>>::iterator assigned);
+	void unindexAssigned(AssignedTask& assigned);
+	boost::optional<ServerID_t> getPreferredServer(std::shared_ptr<Tasks::Task> task);
+	std::deque<ServerID_t>::iterator getFastestRequest();
+	std::shared_ptr<Messages::TaskDataflow> getDataflow(std::shared_ptr<Tasks::Task> task, ServerID_t serverId, bool retry);
+	void releaseInputs(std::shared_ptr<Tasks::Task> task);
+	std::size_t cancelRemoved(const std::vector<std::shared_ptr<Tasks::Task>>& removed);
+	boost::optional<std::shared_ptr<Tasks::Task>> takeExpired();
 };
 
 #endif // _TASKREQUESTQUEUE_HPP_
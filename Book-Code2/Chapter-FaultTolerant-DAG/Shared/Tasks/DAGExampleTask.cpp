@@ -11,12 +11,21 @@ namespace Tasks
 {
 	// -----------------------------------------------------------------
 	//
-	// @details Sleep for a bit.
+	// @details Sleep for a bit, in small steps so a cancel is noticed, and
+	// so the task can make way for more urgent work.
 	//
 	// -----------------------------------------------------------------
 	void DAGExampleTask::execute()
 	{
-		std::this_thread::sleep_for(std::chrono::milliseconds(4000));
+		for (; m_step < 40 && !isCancelled(); m_step++)
+		{
+			if (shouldYield())
+			{
+				suspend();
+				return;
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(100));
+		}
 	}
 
 	// -----------------------------------------------------------------
@@ -19,12 +19,14 @@ namespace Tasks
 	{
 	public:
 		DAGExampleTask(std::string name) :
-			m_name(name)
+			m_name(name),
+			m_step(0)
 		{
 		}
 
 		DAGExampleTask(std::shared_ptr<ip::tcp::socket> socket, Messages::DAGExample& message) :
-			Task(socket, message.getTaskId())
+			Task(socket, message.getTaskId()),
+			m_step(0)
 		{
 			m_name = message.m_message.name();
 		}
@@ -37,6 +39,7 @@ namespace Tasks
 
 	private:
 		std::string m_name;
+		uint32_t m_step;	// Steps already slept, kept when the task suspends itself
 	};
 }
 
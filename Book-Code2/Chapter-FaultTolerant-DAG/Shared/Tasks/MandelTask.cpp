@@ -3,6 +3,7 @@
 #include "Shared/IRange.hpp"
 #include "Shared/Messages/MandelMessage.hpp"
 #include "Shared/Messages/MandelResult.hpp"
+#include "Shared/Threading/ThreadPool.hpp"
 
 #include <algorithm>
 #include <cmath>
@@ -57,7 +58,9 @@ namespace Tasks
 	// -----------------------------------------------------------------
 	//
 	// @details This manages the computation of the pixels for which this
-	// task is responsible.
+	// task is responsible.  Between rows the task checks whether it should
+	// make way for more urgent work, and if so, suspends itself with the
+	// rows done so far kept for when it resumes.
 	//
 	// -----------------------------------------------------------------
 	void MandelTask::execute()
@@ -68,30 +71,57 @@ namespace Tasks
 
 		//
 		// Now that we are about to do some work, reserve the memory we need to store the results.
+		// Filling it here, on the worker, also puts it in memory local to the worker's node.
 		uint16_t rows = (m_endRow - m_startRow) + 1;
-		m_pixels.resize(rows * m_sizeX);
+		if (m_rowDone.empty())
+		{
+			m_pixels.resize(rows * m_sizeX);
+			m_rowDone.assign(rows, 0);
+		}
 
 		//
 		// Premature optimization, I know, but just can't help myself.
 		auto pixels = m_pixels.data();
+		auto rowDone = m_rowDone.data();
 
-		double currentY = m_startY;
-		for (int row = 0; row < rows; row++, currentY += m_deltaY)
-		{
-			double currentX = m_startX;
-			for (int x = 0; x < m_sizeX; x++, currentX += m_deltaX)
+		//
+		// The rows are spread over any idle workers, which matters most near the
+		// end of a frame, when there are fewer tasks left than cores.
+		ThreadPool::instance()->parallelFor(0, rows, 1,
+			[this, pixels, rowDone, log2MaxIterations](std::size_t first, std::size_t last)
 			{
-				auto iterations = computePoint(currentX, currentY, m_maxIterations);
-
-				//
-				// Use the smooth coloring algorithm to determine the color index;
-				double colorIndex = iterations - log2MaxIterations;
-				colorIndex = (colorIndex / m_maxIterations) * 768;
-				colorIndex = std::min(colorIndex, 767.0);
-				colorIndex = std::max(colorIndex, 0.0);
+				double currentY = m_startY + first * m_deltaY;
+				for (auto row = first; row < last && !isCancelled(); row++, currentY += m_deltaY)
+				{
+					if (rowDone[row])
+					{
+						continue;
+					}
+					if (shouldYield())
+					{
+						break;
+					}
+					double currentX = m_startX;
+					for (int x = 0; x < m_sizeX; x++, currentX += m_deltaX)
+					{
+						auto iterations = computePoint(currentX, currentY, m_maxIterations);
+
+						//
+						// Use the smooth coloring algorithm to determine the color index;
+						double colorIndex = iterations - log2MaxIterations;
+						colorIndex = (colorIndex / m_maxIterations) * 768;
+						colorIndex = std::min(colorIndex, 767.0);
+						colorIndex = std::max(colorIndex, 0.0);
+
+						pixels[row * m_sizeX + x] = static_cast<uint16_t>(colorIndex);
+					}
+					rowDone[row] = 1;
+				}
+			});
 
-				pixels[row * m_sizeX + x] = static_cast<uint16_t>(colorIndex);
-			}
+		if (std::find(m_rowDone.begin(), m_rowDone.end(), 0) != m_rowDone.end())
+		{
+			suspend();
 		}
 	}
 
@@ -60,6 +60,7 @@ namespace Tasks
 		double m_deltaY;
 		uint16_t m_maxIterations;
 		std::vector<uint16_t> m_pixels;
+		std::vector<uint8_t> m_rowDone;		// Rows already computed, so a resumed task carries on where it left off
 	};
 }
 
@@ -1,19 +1,36 @@
 #include "Task.hpp"
 
+#include "Shared/ResultCache.hpp"
+#include "Shared/Messages/TaskBatch.hpp"
 #include "Shared/Messages/TaskRequest.hpp"
+#include "Shared/Threading/ThreadPool.hpp"
 
 #include <limits>
 #include <mutex>
 
 namespace Tasks
 {
+	namespace
+	{
+		//
+		// Credits given back to the client that haven't been sent yet.  A compute
+		// server only ever has the one client.
+		std::atomic<uint32_t> returnedCredits(0);
+	}
+
 	// -----------------------------------------------------------------
 	//
 	// @details Standard constructor.  The only important thing that happens
 	// here is that a unique id is assigned to the task.
 	//
 	// -----------------------------------------------------------------
-	Task::Task()
+	Task::Task() :
+		m_costHint(1),
+		m_priority(Priority::Normal),
+		m_groupId(0),
+		m_retainResult(false),
+		m_cancelled(false),
+		m_suspended(false)
 	{
 		static uint64_t currentId = 1;
 		//
@@ -40,10 +57,30 @@ namespace Tasks
 	// -----------------------------------------------------------------
 	Task::Task(std::shared_ptr<ip::tcp::socket> socket, uint64_t id) :
 		m_id(id),
+		m_costHint(1),
+		m_priority(Priority::Normal),
+		m_groupId(0),
+		m_retainResult(false),
+		m_cancelled(false),
+		m_suspended(false),
 		m_socket(socket)
 	{
 	}
 
+	// -----------------------------------------------------------------
+	//
+	// @details Returns true when the task should give up its worker, which
+	// is when a high priority task is waiting and this task isn't one.
+	// Anywhere but on a pool worker, there is nothing to give way to.
+	//
+	// -----------------------------------------------------------------
+	bool Task::shouldYield()
+	{
+		auto worker = WorkerThread::current();
+
+		return m_priority != Priority::High && worker != nullptr && worker->getPool().hasUrgentWork();
+	}
+
 	// -----------------------------------------------------------------
 	//
 	// @details Sends the message over the connected socket, but placing the
@@ -56,6 +93,17 @@ namespace Tasks
 		Messages::send(message, socket, strand);
 	}
 
+	// -----------------------------------------------------------------
+	//
+	// @details Adds the task message to a batch, to be sent along with
+	// other tasks for the same compute server.
+	//
+	// -----------------------------------------------------------------
+	void Task::addTo(Messages::TaskBatch& batch)
+	{
+		batch.add(*getMessage());
+	}
+
 	// ------------------------------------------------------------------
 	//
 	// @details This is a template method pattern.  The completion calls
@@ -70,6 +118,13 @@ namespace Tasks
 		//
 		// Call into the derived class and let it do whatever it wants first
 		auto message = this->completeCustom(ioService);
+		//
+		// Hold on to the result when other tasks need it as input, that way it
+		// doesn't have to come back down from the client.
+		if (m_retainResult)
+		{
+			ResultCache::instance()->add(m_id, Messages::serialize(*message));
+		}
 
 		//
 		// Post the message to the io_service to be returned back to the client.
@@ -77,7 +132,38 @@ namespace Tasks
 
 		//
 		// We send a request for more work
-		auto request = std::make_shared<Messages::TaskRequest>();
-		Messages::send(request, m_socket, ioService);
+		returnCredit(m_socket, ioService);
+	}
+
+	// ------------------------------------------------------------------
+	//
+	// @details Used in place of .complete when the task was cancelled.  No
+	// result is sent, but the task request it was sent in response to has
+	// been used up, so a new one is sent in its place.
+	//
+	// ------------------------------------------------------------------
+	void Task::abandon(boost::asio::io_service& ioService)
+	{
+		returnCredit(m_socket, ioService);
+	}
+
+	// ------------------------------------------------------------------
+	//
+	// @details Gives the client credit for one more task.  Only the first
+	// credit returned since the last request went out posts a new request,
+	// any returned before that request is sent go along with it.
+	//
+	// ------------------------------------------------------------------
+	void Task::returnCredit(std::shared_ptr<ip::tcp::socket> socket, boost::asio::io_service& ioService)
+	{
+		if (returnedCredits.fetch_add(1) == 0)
+		{
+			ioService.post(
+				[socket, &ioService]()
+				{
+					auto credits = returnedCredits.exchange(0);
+					Messages::send(std::make_shared<Messages::TaskRequest>(credits), socket, ioService);
+				});
+		}
 	}
 }
@@ -3,16 +3,52 @@
 
 #include "Shared/Messages/Message.hpp"
 
+#include <atomic>
 #include <chrono>
 #include <functional>
 #include <memory>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include <boost/asio.hpp>
 
 namespace ip = boost::asio::ip;
 
+namespace Messages
+{
+	class TaskBatch;
+}
+
 namespace Tasks
 {
+	// -----------------------------------------------------------------
+	//
+	// @details The result of an earlier task that is used as input to this
+	// one.  On the client only the source id is known.  On the compute server,
+	// the payload is the serialized result message of the source task, which
+	// can be turned back into that message with Messages::parse.
+	//
+	// -----------------------------------------------------------------
+	struct Input
+	{
+		uint64_t sourceId;
+		std::shared_ptr<const std::string> payload;
+	};
+
+	// -----------------------------------------------------------------
+	//
+	// @details How urgently the client wants a task done.  Lower values are
+	// more urgent.
+	//
+	// -----------------------------------------------------------------
+	enum class Priority : uint8_t
+	{
+		High = 0,
+		Normal = 1,
+		Low = 2
+	};
+
 	// -----------------------------------------------------------------
 	//
 	// @details This is the base class from which all tasks are derived.
@@ -27,13 +63,71 @@ namespace Tasks
 		virtual ~Task() {}	// Virtual destructor to allow derived class destructors to correctly get called
 
 		void send(std::shared_ptr<ip::tcp::socket> socket, boost::asio::strand& strand);
+		void addTo(Messages::TaskBatch& batch);
 		virtual void execute() = 0;
 		void complete(boost::asio::io_service& ioService);
+		void abandon(boost::asio::io_service& ioService);
+		static void returnCredit(std::shared_ptr<ip::tcp::socket> socket, boost::asio::io_service& ioService);
 
 		uint64_t getId()							{ return m_id; }
+		//
+		// The relative amount of work the task represents, used by the client
+		// to favor tasks on the longest path through a DAG.  It is never sent
+		// to the compute servers.
+		void setCostHint(uint32_t cost)				{ m_costHint = cost; }
+		uint32_t getCostHint()						{ return m_costHint; }
+		//
+		// Used by the client to order tasks that are ready to go.  Tasks the
+		// task depends upon inherit the priority if it is more urgent than
+		// their own.  It is sent to the servers with the dataflow details, where
+		// high priority tasks go ahead of the others.
+		void setPriority(Priority priority)			{ m_priority = priority; }
+		Priority getPriority()						{ return m_priority; }
+		//
+		// Dataflow support.  A task whose result is input to another task is
+		// asked to retain that result on the compute server, and the inputs are
+		// the results of the tasks it depends upon.
+		void setRetainResult(bool retain)			{ m_retainResult = retain; }
+		bool getRetainResult()						{ return m_retainResult; }
+		void addInput(uint64_t sourceId)			{ m_inputs.push_back(Input{ sourceId, nullptr }); }
+		void setInputs(std::vector<Input> inputs)	{ m_inputs = std::move(inputs); }
+		const std::vector<Input>& getInputs()		{ return m_inputs; }
+		//
+		// Tasks given the same (non-zero) group id can be cancelled together
+		// on the client.  Like the cost hint, it is never sent to the servers.
+		void setGroupId(uint64_t groupId)			{ m_groupId = groupId; }
+		uint64_t getGroupId()						{ return m_groupId; }
+		//
+		// Set on the compute server when the client no longer wants the result.
+		// Long running .execute implementations should check .isCancelled every
+		// so often and return early when it is set.
+		void cancel()								{ m_cancelled = true; }
+		bool isCancelled()							{ return m_cancelled; }
+		//
+		// Cooperative preemption on the compute server.  Long running .execute
+		// implementations call .shouldYield at points where they could stop and
+		// carry on later.  When it returns true, they remember where they got to,
+		// call .suspend and return.  The thread pool calls .execute again later.
+		bool shouldYield();
+		void suspend()								{ m_suspended = true; }
+		void resume()								{ m_suspended = false; }
+		bool isSuspended()							{ return m_suspended; }
+		//
+		// Set by the compute server thread pool, used to measure how long tasks
+		// wait to be started.
+		void setTimeQueued(std::chrono::high_resolution_clock::time_point time)	{ m_timeQueued = time; }
+		std::chrono::high_resolution_clock::time_point getTimeQueued()			{ return m_timeQueued; }
 
 	protected:
 		uint64_t m_id;
+		uint32_t m_costHint;
+		Priority m_priority;
+		uint64_t m_groupId;
+		bool m_retainResult;
+		std::vector<Input> m_inputs;
+		std::atomic<bool> m_cancelled;
+		bool m_suspended;
+		std::chrono::high_resolution_clock::time_point m_timeQueued;
 		std::shared_ptr<ip::tcp::socket> m_socket;
 
 		virtual std::shared_ptr<Messages::Message> getMessage() = 0;
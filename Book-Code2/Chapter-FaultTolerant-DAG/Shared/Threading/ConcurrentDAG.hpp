@@ -1,15 +1,47 @@
 #ifndef _CONCURRENTDAG_HPP_
 #define _CONCURRENTDAG_HPP_
 
+#include "GraphBuilder.hpp"
+
+#include <algorithm>
+#include <array>
 #include <cassert>
 #include <cstdint>
-#include <map>
+#include <deque>
 #include <mutex>
+#include <queue>
 #include <unordered_map>
-#include <unordered_set>
+#include <utility>
+#include <vector>
+
 
+#include <boost/container/small_vector.hpp>
 #include <boost/optional.hpp>
 
+// ------------------------------------------------------------------
+//
+// @details The order in which ready nodes of the same priority are returned
+// from the DAG.
+//   Fifo         : In the order they became ready.
+//   CriticalPath : Largest bottom level first.  The bottom level of a node
+//                  is its own cost plus the costs along the longest chain of
+//                  nodes that depend upon it, so the nodes that hold up the
+//                  most remaining work are started first.  The cost of a node
+//                  comes from its .getCostHint method.
+//
+// ------------------------------------------------------------------
+enum class DAGRanking
+{
+	Fifo,
+	CriticalPath
+};
+
+//
+// Number of priorities the DAG orders by, 0 being the most urgent.  These
+// are the values of Tasks::Priority, anything larger is treated as the
+// least urgent.
+const std::size_t DAG_PRIORITY_LEVELS = 3;
+
 // ------------------------------------------------------------------
 //
 // @details This class provides the Graph structure required to represent
@@ -17,53 +49,115 @@
 // and tracking of items as they are added and removed from the DAG, ensuring
 // that work item are correctly added and ordered for computation.
 //
+// Each node keeps a count of the predecessors it is still waiting on (its
+// in-degree).  When that count reaches zero the node is placed on a ready
+// queue, which allows .dequeue to return the next node without scanning
+// the graph, and .finalize to only visit the direct dependents of the node
+// being removed.
+//
+// Ready nodes are returned most urgent priority first, as given by the
+// .getPriority method of the node, then in the order of the DAG ranking.
+// A node that others depend upon inherits the most urgent priority of any
+// node downstream of it, so an urgent node is never left waiting behind
+// the less urgent nodes it depends upon.
+//
+// Nodes live in a dense table of slots.  When a node is finalized its slot
+// is returned to a free list and reused by the next node added, so the
+// table only ever grows to the largest number of nodes alive at one time.
+// Edges and the ready queue refer to nodes by a Handle, the slot index along
+// with the generation of the slot at the time the handle was made.  The
+// generation is bumped each time a slot is released, which is how stale
+// handles are recognized.
+//
 // ------------------------------------------------------------------
 template <typename T>	// T must be a std::shared_ptr
 class ConcurrentDAG
 {
 public:
+	ConcurrentDAG() :
+		m_ranking(DAGRanking::Fifo),
+		m_sequence(0)
+	{
+	}
+
+	// ------------------------------------------------------------------
+	//
+	// @details Selects the order ready nodes are returned in.  This must be
+	// set before any nodes are added, because the path lengths are computed
+	// as the edges are added.
+	//
+	// ------------------------------------------------------------------
+	void setRanking(DAGRanking ranking)
+	{
+		std::lock_guard<std::recursive_mutex> lock(m_mutex);
+
+		assert(m_slots.empty());
+		m_ranking = ranking;
+	}
+
 	// ------------------------------------------------------------------
 	//
 	// @details A group operation is needed when adding multiple nodes to the DAG
 	// that have dependencies among them.  The group operatrion prevents any other
 	// threads from adding or removing nodes during the group operation.
+	// Prefer .splice when the nodes can be prepared ahead of time, it holds
+	// the lock for much less time.
 	//
 	// ------------------------------------------------------------------
 	void beginGroup()		{ m_mutex.lock(); }
 	void endGroup()			{ m_mutex.unlock(); }
 
+	// ------------------------------------------------------------------
+	//
+	// @details Adds all of the nodes and edges from a graph that was built
+	// up privately by the caller.  All of the allocation and de-duplication
+	// work was done by the builder, so this only links the nodes into the
+	// DAG.  Nodes in the builder may already exist in the DAG, in which
+	// case the new edges are added to the existing node.
+	//
+	// ------------------------------------------------------------------
+	void splice(const GraphBuilder<T>& graph)
+	{
+		std::vector<Handle> handles;
+		handles.reserve(graph.m_nodes.size());
+		//
+		// When ranking by critical path, linking the edges from the bottom of the
+		// graph up means each path length is final before it is passed upward.
+		// The ordering is worked out before taking the lock.
+		auto ranked = (m_ranking == DAGRanking::CriticalPath);
+		auto edges = ranked ? graph.getEdgesDependentsFirst() : std::vector<std::pair<uint32_t, uint32_t>>();
+
+		std::lock_guard<std::recursive_mutex> lock(m_mutex);
+
+		for (std::size_t index = 0; index < graph.m_nodes.size(); index++)
+		{
+			handles.push_back(insertNode(graph.m_nodes[index], graph.m_inDegree[index] == 0));
+		}
+		for (const auto& edge : (ranked ? edges : graph.m_edges))
+		{
+			linkEdge(handles[edge.first], handles[edge.second]);
+		}
+	}
+
 	// ------------------------------------------------------------------
 	//
 	// @details This function allows two nodes that have a dependency between
 	// them to be added.
-	// NOTE: Should probably add code to ensure that a node isn't being added that causes
-	// a dependency on itself.
 	//
 	// ------------------------------------------------------------------
 	void addEdge(T source, T dependent)
 	{
 		std::lock_guard<std::recursive_mutex> lock(m_mutex);
-		//
-		// Add these to the master list of nodes.
-		m_nodes[source->getId()] = source;
-		m_nodes[dependent->getId()] = dependent;
 
+		assert(source->getId() != dependent->getId());
 		//
-		// Add to the adjacency list
-		if (m_adjacent.find(source->getId()) == m_adjacent.end())
-		{
-			m_adjacent[source->getId()] = std::unordered_set<uint64_t>();
-		}
-		m_adjacent[source->getId()].insert(dependent->getId());
+		// Add these to the master list of nodes.  If the dependent was already
+		// sitting on the ready queue, that entry is now stale and gets skipped
+		// by .dequeue.
+		auto handleSource = insertNode(source, true);
+		auto handleDependent = insertNode(dependent, false);
 
-		//
-		// Add the reference back into the adjacency list so that when the node
-		// is removed, it can also be removed from all nodes that depended upon it.
-		if (m_reference.find(dependent->getId()) == m_reference.end())
-		{
-			m_reference[dependent->getId()] = std::unordered_set<uint64_t>();
-		}
-		m_reference[dependent->getId()].insert(source->getId());
+		linkEdge(handleSource, handleDependent);
 	}
 
 	// ------------------------------------------------------------------
@@ -78,10 +172,7 @@ public:
 		// adding a single node is considered a full group operation itself
 		std::lock_guard<std::recursive_mutex> lock(m_mutex);
 
-		m_nodes[one->getId()] = one;
-		//
-		// Create an empty adjacency list
-		m_adjacent[one->getId()] = std::unordered_set<uint64_t>();
+		insertNode(one, true);
 	}
 
 	// ------------------------------------------------------------------
@@ -97,19 +188,22 @@ public:
 
 		boost::optional<T> item = boost::none;
 		//
-		// return the next highest priority item that has no nodes in the adjacency list
-		auto found = bool{ false };
-		for (const auto& candidate : m_nodes)
-		{
-			auto itr = m_reference.find(candidate.first);
-			if ((itr == m_reference.end() || 
-				itr->second.size() == 0) &&
-				m_inUse.find(candidate.first) == m_inUse.end())
+		// Entries on the ready queue may have become stale, because an edge was
+		// added to them after they were queued, or because the slot has since
+		// been released.  Those are discarded here; a live node gets queued
+		// again once its in-degree returns to zero.
+		auto handle = Handle{};
+		while (item == boost::none && popReady(handle))
+		{
+			if (isLive(handle))
 			{
-				found = true;
-				item = candidate.second;
-				m_inUse.insert(candidate.first);
-				break;
+				auto& node = m_slots[handle.slot];
+				node.queued = false;
+				if (node.inDegree == 0 && !node.inUse)
+				{
+					node.inUse = true;
+					item = node.item;
+				}
 			}
 		}
 
@@ -118,7 +212,26 @@ public:
 
 	// ------------------------------------------------------------------
 	//
-	// @details Removes (finalizes) the node from the DAG. This node must 
+	// @details Puts a node that was returned from the .dequeue method back
+	// on the ready queue, used when the work done on it has been lost.
+	// Nothing happens if the node is no longer in the DAG.
+	//
+	// ------------------------------------------------------------------
+	void requeue(const T& node)
+	{
+		std::lock_guard<std::recursive_mutex> lock(m_mutex);
+
+		auto itr = m_index.find(node->getId());
+		if (itr != m_index.end() && m_slots[itr->second.slot].inUse)
+		{
+			m_slots[itr->second.slot].inUse = false;
+			enqueueReady(itr->second);
+		}
+	}
+
+	// ------------------------------------------------------------------
+	//
+	// @details Removes (finalizes) the node from the DAG. This node must
 	// have been returned from the .dequeue method!
 	//
 	// ------------------------------------------------------------------
@@ -128,27 +241,528 @@ public:
 		// remove is considered a full group operation itself
 		std::lock_guard<std::recursive_mutex> lock(m_mutex);
 
+		auto itr = m_index.find(node->getId());
 		//
 		// As a quick gut check, just make sure it really is in the inUse
-		// container...that means that it was dequeued.
-		assert(m_inUse.find(node->getId()) != m_inUse.end());
+		// state...that means that it was dequeued.
+		assert(itr != m_index.end() && m_slots[itr->second.slot].inUse);
 		//
-		// Using the adjacent list, remove it from the reference sets
-		for (auto id : m_adjacent[node->getId()])
+		// Release each of the dependents, any that no longer wait on anything
+		// become ready for work.
+		auto handle = itr->second;
+		for (auto dependent : m_slots[handle.slot].dependents)
 		{
-			m_reference[id].erase(node->getId());
+			if (isLive(dependent))
+			{
+				auto& nodeDependent = m_slots[dependent.slot];
+				assert(nodeDependent.inDegree > 0);
+				if (--nodeDependent.inDegree == 0)
+				{
+					enqueueReady(dependent);
+				}
+			}
 		}
-		m_adjacent.erase(node->getId());
-		m_nodes.erase(node->getId());
-		m_inUse.erase(node->getId());
+		m_index.erase(itr);
+		releaseSlot(handle.slot);
+	}
+
+	// ------------------------------------------------------------------
+	//
+	// @details Removes the node, along with every node that directly or
+	// indirectly depends upon it, from the DAG.  The removed nodes are
+	// returned; any of them that were dequeued, but not yet finalized, must
+	// not be finalized.  Nothing is removed if the node isn't in the DAG.
+	//
+	// ------------------------------------------------------------------
+	std::vector<T> cancel(uint64_t id)
+	{
+		std::lock_guard<std::recursive_mutex> lock(m_mutex);
+
+		std::vector<T> removed;
+		auto itr = m_index.find(id);
+		if (itr != m_index.end())
+		{
+			removeClosure(std::vector<Handle>{ itr->second }, removed);
+		}
+
+		return removed;
+	}
+
+	// ------------------------------------------------------------------
+	//
+	// @details Same as .cancel, but for every node with the given group id,
+	// as returned by its .getGroupId method.
+	//
+	// ------------------------------------------------------------------
+	std::vector<T> cancelGroup(uint64_t groupId)
+	{
+		std::lock_guard<std::recursive_mutex> lock(m_mutex);
+
+		std::vector<Handle> roots;
+		for (const auto& entry : m_index)
+		{
+			if (m_slots[entry.second.slot].item->getGroupId() == groupId)
+			{
+				roots.push_back(entry.second);
+			}
+		}
+
+		std::vector<T> removed;
+		removeClosure(roots, removed);
+
+		return removed;
+	}
+
+	// ------------------------------------------------------------------
+	//
+	// @details Returns true if the node is (still) in the DAG.
+	//
+	// ------------------------------------------------------------------
+	bool contains(uint64_t id)
+	{
+		std::lock_guard<std::recursive_mutex> lock(m_mutex);
+
+		return m_index.find(id) != m_index.end();
+	}
+
+	// ------------------------------------------------------------------
+	//
+	// @details Returns the bottom level of the node, or zero if the node
+	// isn't in the DAG or the DAG isn't ranking by critical path.
+	//
+	// ------------------------------------------------------------------
+	uint64_t getLevel(const T& node)
+	{
+		std::lock_guard<std::recursive_mutex> lock(m_mutex);
+
+		auto itr = m_index.find(node->getId());
+		if (m_ranking != DAGRanking::CriticalPath || itr == m_index.end())
+		{
+			return 0;
+		}
+
+		return m_ranks[itr->second.slot].level;
+	}
+
+	// ------------------------------------------------------------------
+	//
+	// @details Returns true if the node is on the critical path of what is
+	// left to do: its bottom level is greater than that of the next node to
+	// come off the ready queue.  With nothing else ready, a node is critical
+	// if it has dependents still waiting on it.  Always false unless ranking
+	// by critical path.
+	//
+	// ------------------------------------------------------------------
+	bool isCritical(const T& node)
+	{
+		std::lock_guard<std::recursive_mutex> lock(m_mutex);
+
+		auto itr = m_index.find(node->getId());
+		if (m_ranking != DAGRanking::CriticalPath || itr == m_index.end())
+		{
+			return false;
+		}
+
+		auto& rank = m_ranks[itr->second.slot];
+		auto level = uint64_t{ 0 };
+		if (peekReadyLevel(level))
+		{
+			return rank.level > level;
+		}
+
+		return rank.level > rank.cost;
 	}
 
 private:
+	struct Handle
+	{
+		uint32_t slot;
+		uint32_t generation;
+	};
+
+	struct Node
+	{
+		Node() :
+			generation(0),
+			inDegree(0),
+			priority(0),
+			queued(false),
+			inUse(false)
+		{
+		}
+
+		T item;
+		boost::container::small_vector<Handle, 1> dependents;	// Nodes that can not start until this one is finalized
+		boost::container::small_vector<Handle, 1> predecessors;	// Nodes this one depends upon
+		uint32_t generation;									// Bumped every time the slot is released
+		uint32_t inDegree;										// Number of nodes this one is still waiting on
+		uint8_t priority;										// Own priority, or a more urgent one inherited from a dependent
+		bool queued;											// Currently on the ready queue
+		bool inUse;												// Dequeued, but not yet finalized
+	};
+
+	//
+	// Only used when ranking by critical path, kept apart from the nodes so
+	// the FIFO ordering doesn't pay for it.
+	struct Rank
+	{
+		uint64_t cost;
+		uint64_t level;		// Cost of the longest path starting at this node
+	};
+
+	struct RankedEntry
+	{
+		uint8_t priority;
+		uint64_t level;
+		uint64_t sequence;
+		Handle handle;
+	};
+
+	struct RankedEntryCompare
+	{
+		bool operator()(const RankedEntry& lhs, const RankedEntry& rhs) const
+		{
+			//
+			// Most urgent priority first, then the longest path, then the order
+			// they became ready
+			if (lhs.priority != rhs.priority)
+			{
+				return lhs.priority > rhs.priority;
+			}
+			if (lhs.level != rhs.level)
+			{
+				return lhs.level < rhs.level;
+			}
+			return lhs.sequence > rhs.sequence;
+		}
+	};
+
 	std::recursive_mutex m_mutex;
-	std::map<uint64_t, T> m_nodes;												// Set of all nodes in the graph
-	std::unordered_map<uint64_t, std::unordered_set<uint64_t>> m_adjacent;		// Adjacency list
-	std::unordered_map<uint64_t, std::unordered_set<uint64_t>> m_reference;		// Set of nodes to which each node is referenced in the adjacency list
-	std::unordered_set<uint64_t> m_inUse;										// Set of nodes dequeued, but not yet removed
+	DAGRanking m_ranking;
+	std::vector<Node> m_slots;						// Every node in the graph, along with released slots
+	std::vector<Rank> m_ranks;						// Same slots as m_slots, when ranking by critical path
+	std::vector<uint32_t> m_free;					// Released slots available for reuse
+	std::unordered_map<uint64_t, Handle> m_index;	// Node id to its current slot
+	std::array<std::deque<Handle>, DAG_PRIORITY_LEVELS> m_ready;	// Nodes whose in-degree was zero when queued, by priority
+	std::priority_queue<RankedEntry, std::vector<RankedEntry>, RankedEntryCompare> m_readyRanked;
+	uint64_t m_sequence;
+
+	// ------------------------------------------------------------------
+	//
+	// @details Returns the handle for this item, adding it to the graph if
+	// it isn't already there.  A newly added node is also placed on the
+	// ready queue when requested.
+	//
+	// ------------------------------------------------------------------
+	Handle insertNode(const T& item, bool ready)
+	{
+		auto itr = m_index.find(item->getId());
+		if (itr != m_index.end())
+		{
+			return itr->second;
+		}
+
+		auto handle = acquireSlot();
+		m_slots[handle.slot].item = item;
+		m_slots[handle.slot].priority = static_cast<uint8_t>(std::min(static_cast<std::size_t>(item->getPriority()), DAG_PRIORITY_LEVELS - 1));
+		m_index[item->getId()] = handle;
+		if (m_ranking == DAGRanking::CriticalPath)
+		{
+			auto& rank = m_ranks[handle.slot];
+			rank.cost = item->getCostHint();
+			rank.level = rank.cost;
+		}
+		if (ready)
+		{
+			enqueueReady(handle);
+		}
+
+		return handle;
+	}
+
+	// ------------------------------------------------------------------
+	//
+	// @details Returns a handle to an empty slot, reusing a released slot
+	// whenever one is available.
+	//
+	// ------------------------------------------------------------------
+	Handle acquireSlot()
+	{
+		auto slot = uint32_t{ 0 };
+		if (!m_free.empty())
+		{
+			slot = m_free.back();
+			m_free.pop_back();
+		}
+		else
+		{
+			slot = static_cast<uint32_t>(m_slots.size());
+			m_slots.emplace_back();
+			if (m_ranking == DAGRanking::CriticalPath)
+			{
+				m_ranks.emplace_back();
+			}
+		}
+
+		return Handle{ slot, m_slots[slot].generation };
+	}
+
+	// ------------------------------------------------------------------
+	//
+	// @details Empties the slot and makes it available for reuse.  Any handles
+	// still referring to it are invalidated by the generation change.
+	//
+	// ------------------------------------------------------------------
+	void releaseSlot(uint32_t slot)
+	{
+		auto& node = m_slots[slot];
+		node.item.reset();
+		//
+		// Swap rather than clear, so a node that had a large number of dependents
+		// doesn't leave that memory attached to the slot.
+		decltype(node.dependents)().swap(node.dependents);
+		decltype(node.predecessors)().swap(node.predecessors);
+		node.generation++;
+		node.inDegree = 0;
+		node.priority = 0;
+		node.queued = false;
+		node.inUse = false;
+
+		m_free.push_back(slot);
+	}
+
+	bool isLive(Handle handle)
+	{
+		return m_slots[handle.slot].generation == handle.generation;
+	}
+
+	// ------------------------------------------------------------------
+	//
+	// @details Removes the nodes and everything downstream of them.  A slot
+	// is released as soon as its node is visited, so any other path reaching
+	// the same node finds a stale handle and stops there.  Entries left on
+	// the ready queue are skipped by .dequeue the same way.  The levels of
+	// nodes upstream of those removed are left as they were; they can only
+	// be too high, which just means they are favored a little more.
+	//
+	// ------------------------------------------------------------------
+	void removeClosure(std::vector<Handle> pending, std::vector<T>& removed)
+	{
+		while (!pending.empty())
+		{
+			auto handle = pending.back();
+			pending.pop_back();
+			if (isLive(handle))
+			{
+				auto& node = m_slots[handle.slot];
+				pending.insert(pending.end(), node.dependents.begin(), node.dependents.end());
+
+				m_index.erase(node.item->getId());
+				removed.push_back(node.item);
+				releaseSlot(handle.slot);
+			}
+		}
+	}
+
+	// ------------------------------------------------------------------
+	//
+	// @details Records the dependency between two nodes already in the DAG.
+	// The source (and anything it depends upon) inherits the priority of the
+	// dependent if it is more urgent.  When ranking by critical path, the
+	// source may also now be on a longer path, so the new length is passed
+	// upward.
+	//
+	// ------------------------------------------------------------------
+	void linkEdge(Handle source, Handle dependent)
+	{
+		m_slots[source.slot].dependents.push_back(dependent);
+		m_slots[dependent.slot].predecessors.push_back(source);
+		m_slots[dependent.slot].inDegree++;
+
+		inheritPriority(source, m_slots[dependent.slot].priority);
+
+		if (m_ranking == DAGRanking::CriticalPath)
+		{
+			//
+			// Each pending entry is a node along with the level it would have
+			// through the path that just grew.
+			std::vector<std::pair<Handle, uint64_t>> pending;
+			pending.push_back(std::make_pair(source, m_ranks[source.slot].cost + m_ranks[dependent.slot].level));
+			while (!pending.empty())
+			{
+				auto handle = pending.back().first;
+				auto level = pending.back().second;
+				pending.pop_back();
+
+				auto& rank = m_ranks[handle.slot];
+				if (level > rank.level)
+				{
+					rank.level = level;
+					//
+					// A node already waiting in the ready queue needs a new entry to
+					// reflect its new level, the old entry is skipped when popped.
+					if (m_slots[handle.slot].queued)
+					{
+						pushReady(handle);
+					}
+					for (auto previous : m_slots[handle.slot].predecessors)
+					{
+						if (isLive(previous))
+						{
+							pending.push_back(std::make_pair(previous, m_ranks[previous.slot].cost + level));
+						}
+					}
+				}
+			}
+		}
+	}
+
+	// ------------------------------------------------------------------
+	//
+	// @details Gives the node, and everything upstream of it, the priority if
+	// it is more urgent than the one they have.  Items not yet dequeued are
+	// given the new priority too, so it goes with them wherever they are
+	// sent.  A node already waiting in the ready queue gets a new entry at
+	// its new priority, the old entry is skipped when popped.
+	//
+	// ------------------------------------------------------------------
+	void inheritPriority(Handle handle, uint8_t priority)
+	{
+		std::vector<Handle> pending{ handle };
+		while (!pending.empty())
+		{
+			auto current = pending.back();
+			pending.pop_back();
+
+			auto& node = m_slots[current.slot];
+			if (priority < node.priority)
+			{
+				node.priority = priority;
+				if (!node.inUse)
+				{
+					node.item->setPriority(static_cast<decltype(node.item->getPriority())>(priority));
+				}
+				if (node.queued)
+				{
+					pushReady(current);
+				}
+				for (auto previous : node.predecessors)
+				{
+					if (isLive(previous))
+					{
+						pending.push_back(previous);
+					}
+				}
+			}
+		}
+	}
+
+	// ------------------------------------------------------------------
+	//
+	// @details Places the node on the ready queue, unless it is already there.
+	//
+	// ------------------------------------------------------------------
+	void enqueueReady(Handle handle)
+	{
+		auto& node = m_slots[handle.slot];
+		if (!node.queued)
+		{
+			node.queued = true;
+			pushReady(handle);
+		}
+	}
+
+	// ------------------------------------------------------------------
+	//
+	// @details Adds an entry for the node to the ready queue, at its current
+	// priority and level.
+	//
+	// ------------------------------------------------------------------
+	void pushReady(Handle handle)
+	{
+		auto priority = m_slots[handle.slot].priority;
+		if (m_ranking == DAGRanking::CriticalPath)
+		{
+			m_readyRanked.push(RankedEntry{ priority, m_ranks[handle.slot].level, m_sequence++, handle });
+		}
+		else
+		{
+			m_ready[priority].push_back(handle);
+		}
+	}
+
+	// ------------------------------------------------------------------
+	//
+	// @details Takes the next entry off of the ready queue, returns false if
+	// the queue is empty.  Entries made out of date by a change in priority
+	// or level are discarded here.
+	//
+	// ------------------------------------------------------------------
+	bool popReady(Handle& handle)
+	{
+		if (m_ranking == DAGRanking::CriticalPath)
+		{
+			while (!m_readyRanked.empty())
+			{
+				auto entry = m_readyRanked.top();
+				m_readyRanked.pop();
+				if (!isLive(entry.handle) ||
+					(entry.level == m_ranks[entry.handle.slot].level && entry.priority == m_slots[entry.handle.slot].priority))
+				{
+					handle = entry.handle;
+					return true;
+				}
+			}
+			return false;
+		}
+
+		for (std::size_t priority = 0; priority < m_ready.size(); priority++)
+		{
+			auto& ready = m_ready[priority];
+			while (!ready.empty())
+			{
+				auto entry = ready.front();
+				ready.pop_front();
+				if (!isLive(entry) || m_slots[entry.slot].priority == priority)
+				{
+					handle = entry;
+					return true;
+				}
+			}
+		}
+
+		return false;
+	}
+
+	// ------------------------------------------------------------------
+	//
+	// @details Gets the bottom level of the entry at the front of the ranked
+	// ready queue, returns false if there is none.  Entries that dequeue
+	// would discard are discarded here too, so they don't hide the entry
+	// behind them.
+	//
+	// ------------------------------------------------------------------
+	bool peekReadyLevel(uint64_t& level)
+	{
+		while (!m_readyRanked.empty())
+		{
+			auto entry = m_readyRanked.top();
+			if (isLive(entry.handle) &&
+				entry.level == m_ranks[entry.handle.slot].level && entry.priority == m_slots[entry.handle.slot].priority)
+			{
+				auto& node = m_slots[entry.handle.slot];
+				if (node.inDegree == 0 && !node.inUse)
+				{
+					level = entry.level;
+					return true;
+				}
+				node.queued = false;
+			}
+			m_readyRanked.pop();
+		}
+
+		return false;
+	}
 };
 
 #endif // _CONCURRENTDAG_HPP_
@@ -0,0 +1,189 @@
+#ifndef _GRAPHBUILDER_HPP_
+#define _GRAPHBUILDER_HPP_
+
+#include <cassert>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+template <typename T>
+class ConcurrentDAG;
+
+// ------------------------------------------------------------------
+//
+// @details This class is used to put together a set of nodes, along with
+// the dependencies among them, without touching a ConcurrentDAG.  Nothing
+// here is synchronized; the builder is expected to be owned by a single
+// thread.  Once complete, the whole thing is handed to ConcurrentDAG::splice,
+// which adds it to the DAG in a single, short, critical section.
+//
+// ------------------------------------------------------------------
+template <typename T>	// T must be a std::shared_ptr
+class GraphBuilder
+{
+public:
+	// ------------------------------------------------------------------
+	//
+	// @details Adds a node that has no dependencies to or from any other
+	// nodes in the graph.
+	//
+	// ------------------------------------------------------------------
+	void addNode(T one)
+	{
+		insert(one);
+	}
+
+	// ------------------------------------------------------------------
+	//
+	// @details Adds two nodes, with the dependent not able to be computed
+	// until the source has finished.
+	//
+	// ------------------------------------------------------------------
+	void addEdge(T source, T dependent)
+	{
+		assert(source->getId() != dependent->getId());
+
+		auto indexSource = insert(source);
+		auto indexDependent = insert(dependent);
+		m_edges.push_back(std::make_pair(indexSource, indexDependent));
+		m_inDegree[indexDependent]++;
+	}
+
+	// ------------------------------------------------------------------
+	//
+	// @details Adds a source along with a list of nodes that depend upon it.
+	//
+	// ------------------------------------------------------------------
+	void addEdges(T source, const std::vector<T>& dependents)
+	{
+		m_edges.reserve(m_edges.size() + dependents.size());
+		for (const auto& dependent : dependents)
+		{
+			addEdge(source, dependent);
+		}
+	}
+
+	// ------------------------------------------------------------------
+	//
+	// @details Adds a list of sources that all must finish before the
+	// dependent can be computed.
+	//
+	// ------------------------------------------------------------------
+	void addEdges(const std::vector<T>& sources, T dependent)
+	{
+		m_edges.reserve(m_edges.size() + sources.size());
+		for (const auto& source : sources)
+		{
+			addEdge(source, dependent);
+		}
+	}
+
+	bool empty()		{ return m_nodes.empty(); }
+
+private:
+	friend class ConcurrentDAG<T>;
+
+	std::vector<T> m_nodes;									// Every node, in the order first added
+	std::vector<uint32_t> m_inDegree;						// Number of edges into each node, same order as m_nodes
+	std::vector<std::pair<uint32_t, uint32_t>> m_edges;		// Source/dependent pairs, as indices into m_nodes
+	std::unordered_map<uint64_t, uint32_t> m_index;			// Node id to its index in m_nodes
+
+	// ------------------------------------------------------------------
+	//
+	// @details Returns the edges ordered so that every edge leaving a node
+	// comes before any edge entering that node.  In other words, the edges
+	// are grouped by source, with the sources visited in reverse topological
+	// order.  This allows the DAG to compute path lengths from the bottom of
+	// the graph up, touching each edge only once.
+	//
+	// ------------------------------------------------------------------
+	std::vector<std::pair<uint32_t, uint32_t>> getEdgesDependentsFirst() const
+	{
+		//
+		// Build compressed lists of the edges leaving and entering each node
+		auto count = m_nodes.size();
+		std::vector<uint32_t> outStart(count + 1, 0);
+		std::vector<uint32_t> inStart(count + 1, 0);
+		for (const auto& edge : m_edges)
+		{
+			outStart[edge.first + 1]++;
+			inStart[edge.second + 1]++;
+		}
+		for (std::size_t node = 0; node < count; node++)
+		{
+			outStart[node + 1] += outStart[node];
+			inStart[node + 1] += inStart[node];
+		}
+		std::vector<uint32_t> outEdges(m_edges.size());
+		std::vector<uint32_t> inEdges(m_edges.size());
+		{
+			auto outNext = outStart;
+			auto inNext = inStart;
+			for (uint32_t edge = 0; edge < m_edges.size(); edge++)
+			{
+				outEdges[outNext[m_edges[edge].first]++] = edge;
+				inEdges[inNext[m_edges[edge].second]++] = edge;
+			}
+		}
+
+		//
+		// Peel nodes off the bottom of the graph, a node is emitted once all of
+		// the nodes depending upon it have been emitted.
+		std::vector<uint32_t> remaining(count);
+		std::vector<uint32_t> pending;
+		for (uint32_t node = 0; node < count; node++)
+		{
+			remaining[node] = outStart[node + 1] - outStart[node];
+			if (remaining[node] == 0)
+			{
+				pending.push_back(node);
+			}
+		}
+
+		std::vector<std::pair<uint32_t, uint32_t>> ordered;
+		ordered.reserve(m_edges.size());
+		while (!pending.empty())
+		{
+			auto node = pending.back();
+			pending.pop_back();
+			for (auto position = outStart[node]; position < outStart[node + 1]; position++)
+			{
+				ordered.push_back(m_edges[outEdges[position]]);
+			}
+			for (auto position = inStart[node]; position < inStart[node + 1]; position++)
+			{
+				auto source = m_edges[inEdges[position]].first;
+				if (--remaining[source] == 0)
+				{
+					pending.push_back(source);
+				}
+			}
+		}
+		//
+		// If not every edge was emitted, the graph has a cycle in it.
+		assert(ordered.size() == m_edges.size());
+
+		return ordered;
+	}
+
+	// ------------------------------------------------------------------
+	//
+	// @details Returns the index of the node, adding it if this is the
+	// first time it has been seen.
+	//
+	// ------------------------------------------------------------------
+	uint32_t insert(const T& item)
+	{
+		auto result = m_index.emplace(item->getId(), static_cast<uint32_t>(m_nodes.size()));
+		if (result.second)
+		{
+			m_nodes.push_back(item);
+			m_inDegree.push_back(0);
+		}
+
+		return result.first->second;
+	}
+};
+
+#endif // _GRAPHBUILDER_HPP_
@@ -0,0 +1,203 @@
+#ifndef _INDEXEDHEAP_HPP_
+#define _INDEXEDHEAP_HPP_
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// ------------------------------------------------------------------
+//
+// @details An indexed d-ary min heap, four children to a node unless
+// told otherwise.  The heap is kept in one contiguous array of key and
+// priority pairs, along with an index of where each key is in the array.
+// That way the priority of any key can be changed, or the key removed,
+// in logarithmic time, without leaving anything behind in the heap to be
+// skipped over later.
+//
+// With four children the heap is half as deep as a binary heap, and the
+// children of a node sit next to each other, so sifting down touches
+// about the same number of cache lines while making half as many moves.
+// Nothing here is synchronized, the owner is expected to provide any
+// locking.
+//
+// ------------------------------------------------------------------
+template <typename K, typename P, std::size_t D = 4, typename Compare = std::less<P>>
+class IndexedHeap
+{
+public:
+	static_assert(D >= 2, "A heap needs at least two children to a node");
+
+	bool empty() const				{ return m_heap.empty(); }
+	std::size_t size() const		{ return m_heap.size(); }
+	bool contains(const K& key) const	{ return m_index.find(key) != m_index.end(); }
+	void reserve(std::size_t count)	{ m_heap.reserve(count); m_index.reserve(count); }
+
+	const K& topKey() const			{ return m_heap.front().first; }
+	const P& topPriority() const	{ return m_heap.front().second; }
+
+	// ------------------------------------------------------------------
+	//
+	// @details Sets the priority for the key, adding the key if it isn't
+	// already in the heap.
+	//
+	// ------------------------------------------------------------------
+	void set(const K& key, const P& priority)
+	{
+		auto entry = m_index.find(key);
+		if (entry == m_index.end())
+		{
+			m_heap.emplace_back(key, priority);
+			m_index.emplace(key, m_heap.size() - 1);
+			siftUp(m_heap.size() - 1);
+			return;
+		}
+
+		auto position = entry->second;
+		auto raised = m_compare(priority, m_heap[position].second);
+		m_heap[position].second = priority;
+		if (raised)
+		{
+			siftUp(position);
+		}
+		else
+		{
+			siftDown(position);
+		}
+	}
+
+	// ------------------------------------------------------------------
+	//
+	// @details Removes the key from the heap.  Returns false if the key
+	// wasn't there.
+	//
+	// ------------------------------------------------------------------
+	bool erase(const K& key)
+	{
+		auto entry = m_index.find(key);
+		if (entry == m_index.end())
+		{
+			return false;
+		}
+
+		auto position = entry->second;
+		m_index.erase(entry);
+		removeAt(position);
+
+		return true;
+	}
+
+	// ------------------------------------------------------------------
+	//
+	// @details Removes the key with the lowest priority.  The heap must
+	// not be empty.
+	//
+	// ------------------------------------------------------------------
+	void pop()
+	{
+		m_index.erase(m_heap.front().first);
+		removeAt(0);
+	}
+
+private:
+	std::vector<std::pair<K, P>> m_heap;
+	std::unordered_map<K, std::size_t> m_index;		// Position of each key in m_heap
+	Compare m_compare;
+
+	// ------------------------------------------------------------------
+	//
+	// @details Fills the hole at the position with the last entry, then
+	// moves that entry whichever way it needs to go.  The key at the
+	// position must already be gone from the index.
+	//
+	// ------------------------------------------------------------------
+	void removeAt(std::size_t position)
+	{
+		auto last = m_heap.size() - 1;
+		if (position != last)
+		{
+			m_heap[position] = std::move(m_heap[last]);
+			m_heap.pop_back();
+			m_index[m_heap[position].first] = position;
+			if (position > 0 && m_compare(m_heap[position].second, m_heap[(position - 1) / D].second))
+			{
+				siftUp(position);
+			}
+			else
+			{
+				siftDown(position);
+			}
+		}
+		else
+		{
+			m_heap.pop_back();
+		}
+	}
+
+	// ------------------------------------------------------------------
+	//
+	// @details Moves the entry toward the root until its parent is no
+	// greater.  Entries passed over are shifted down rather than swapped,
+	// the moving entry is only written once it has found its place.
+	//
+	// ------------------------------------------------------------------
+	void siftUp(std::size_t position)
+	{
+		auto moving = std::move(m_heap[position]);
+		while (position > 0)
+		{
+			auto parent = (position - 1) / D;
+			if (!m_compare(moving.second, m_heap[parent].second))
+			{
+				break;
+			}
+			m_heap[position] = std::move(m_heap[parent]);
+			m_index[m_heap[position].first] = position;
+			position = parent;
+		}
+		m_heap[position] = std::move(moving);
+		m_index[m_heap[position].first] = position;
+	}
+
+	// ------------------------------------------------------------------
+	//
+	// @details Moves the entry away from the root until none of its
+	// children are less than it.
+	//
+	// ------------------------------------------------------------------
+	void siftDown(std::size_t position)
+	{
+		auto moving = std::move(m_heap[position]);
+		auto count = m_heap.size();
+		for (;;)
+		{
+			auto first = position * D + 1;
+			if (first >= count)
+			{
+				break;
+			}
+			auto least = first;
+			auto end = std::min(first + D, count);
+			for (auto child = first + 1; child < end; child++)
+			{
+				if (m_compare(m_heap[child].second, m_heap[least].second))
+				{
+					least = child;
+				}
+			}
+			if (!m_compare(m_heap[least].second, moving.second))
+			{
+				break;
+			}
+			m_heap[position] = std::move(m_heap[least]);
+			m_index[m_heap[position].first] = position;
+			position = least;
+		}
+		m_heap[position] = std::move(moving);
+		m_index[m_heap[position].first] = position;
+	}
+};
+
+#endif // _INDEXEDHEAP_HPP_
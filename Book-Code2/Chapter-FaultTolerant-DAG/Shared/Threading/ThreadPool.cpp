@@ -1,8 +1,43 @@
 #include "ThreadPool.hpp"
+#include "Topology.hpp"
 
 #include "Shared/IRange.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <utility>
+
+#include <boost/chrono/process_cpu_clocks.hpp>
+
 std::shared_ptr<ThreadPool> ThreadPool::m_instance = nullptr;
+uint16_t ThreadPool::m_configMinimum = 0;
+uint16_t ThreadPool::m_configMaximum = 0;
+ThreadPool::Placement ThreadPool::m_configPlacement = ThreadPool::Placement::None;
+
+namespace
+{
+	//
+	// How often the pool size is reconsidered
+	const auto SIZE_INTERVAL = std::chrono::milliseconds(100);
+	//
+	// Tasks waiting longer than this to start, on average, are a sign there
+	// aren't enough workers.
+	const auto WAIT_THRESHOLD = std::chrono::milliseconds(5);
+	//
+	// Fraction of the cores in use below which the CPU is considered to have
+	// room for more workers, and above which it is considered saturated.  The
+	// gap between them keeps the size from bouncing back and forth.
+	const double CPU_ROOM = 0.85;
+	const double CPU_SATURATED = 0.95;
+	//
+	// Fraction of the time the workers can sit parked before one is retired
+	const double IDLE_THRESHOLD = 0.5;
+	//
+	// Number of pieces per active worker a parallel for loop is split into
+	// when the grain isn't given.
+	const std::size_t PIECES_PER_WORKER = 8;
+}
 
 // -----------------------------------------------------------------
 //
@@ -14,44 +49,567 @@ std::shared_ptr<ThreadPool> ThreadPool::instance()
 	if (m_instance)		return m_instance;
 
 	//
-	// We add a few extra threads to allow for some of them to be sitting around on other threads
-	// to complete operations.  We could dynamically adjust this at runtime, up or down, by looking
-	// at the amount of time spent waiting in the queue, but that is more than I'm willing to do
-	// for this demo code :)
-	auto threads = uint16_t{ static_cast<uint16_t>(std::thread::hardware_concurrency() + 4) };
-	m_instance = std::shared_ptr<ThreadPool>(new ThreadPool(threads));
+	// Start with one worker per core, which suits CPU bound tasks, and let the
+	// pool adjust from there.  Unless configured otherwise, the pool can shrink
+	// down to a single worker, and grow to several per core to cover tasks that
+	// spend their time blocked.
+	auto cores = static_cast<uint16_t>(std::max(1u, std::thread::hardware_concurrency()));
+	auto sizeMinimum = m_configMinimum > 0 ? m_configMinimum : uint16_t{ 1 };
+	auto sizeMaximum = m_configMaximum > 0 ? m_configMaximum : static_cast<uint16_t>(std::max(16, cores * 4));
+	sizeMaximum = std::max(sizeMinimum, sizeMaximum);
+	auto sizeInitial = std::min(std::max(cores, sizeMinimum), sizeMaximum);
+	m_instance = std::shared_ptr<ThreadPool>(new ThreadPool(sizeMinimum, sizeInitial, sizeMaximum, m_configPlacement));
 
 	return m_instance;
 }
 
+// -----------------------------------------------------------------
+//
+// @details Sets the bounds on the number of workers and how they are
+// placed on the cores.  This must be called before the first call to
+// .instance to have any effect.
+//
+// -----------------------------------------------------------------
+void ThreadPool::configure(uint16_t sizeMinimum, uint16_t sizeMaximum, Placement placement)
+{
+	m_configMinimum = sizeMinimum;
+	m_configMaximum = sizeMaximum;
+	m_configPlacement = placement;
+}
+
 // -----------------------------------------------------------------
 //
 // @details The constructor creates the worker threads the thread pool
-// will use to process tasks.
+// will use to process tasks.  A worker is created for every slot up to
+// the maximum size, because each one may steal from any of the others
+// and the set can't change once running, but only the initial number of
+// them are started.
 //
 // -----------------------------------------------------------------
-ThreadPool::ThreadPool(uint16_t sizeInitial)
+ThreadPool::ThreadPool(uint16_t sizeMinimum, uint16_t sizeInitial, uint16_t sizeMaximum, Placement placement) :
+	m_ioService(nullptr),
+	m_active(0),
+	m_started(0),
+	m_sizeMinimum(sizeMinimum),
+	m_sizeMaximum(sizeMaximum),
+	m_nextInbox(0),
+	m_urgentCount(0),
+	m_nodeCount(1),
+	m_done(false),
+	m_parkedCount(0)
 {
-	for (auto thread : IRange<uint16_t>(1, sizeInitial))
+	for (auto thread : IRange<uint16_t>(1, sizeMaximum))
 	{
-		auto worker = std::make_shared<WorkerThread>(m_workQueue, m_eventWorkQueue, m_mutexWorkQueue);
-		m_threads.insert(worker);
+		auto worker = std::make_shared<WorkerThread>(*this, static_cast<uint16_t>(m_threads.size()));
+		m_threads.push_back(worker);
 	}
+	m_parked.reserve(m_threads.size());
+
+	if (placement != Placement::None)
+	{
+		place(placement);
+	}
+
+	resize(sizeInitial);
+
+	m_controller = std::make_shared<std::thread>(&ThreadPool::controlSize, this);
 }
 
 // -----------------------------------------------------------------
 //
-// @details This places a new task on the work queue.  An event
-// will be signled to one of the waiting threads.
+// @details This places a new task on the work queue, see .queueTask.
 //
 // -----------------------------------------------------------------
 void ThreadPool::enqueueTask(std::shared_ptr<Tasks::Task> source)
 {
-	m_workQueue.enqueue(source);
+	{
+		auto& shard = getShard(source->getId());
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		shard.tasks.emplace(source->getId(), source);
+	}
+
+	queueTask(source.get());
+}
+
+// -----------------------------------------------------------------
+//
+// @details Flags the task as cancelled.  A task still in the work queue
+// is dropped when a worker reaches it, one that is running is expected to
+// notice and stop early.  Nothing happens if the task has already finished.
+//
+// -----------------------------------------------------------------
+void ThreadPool::cancelTask(uint64_t taskId)
+{
+	auto& shard = getShard(taskId);
+	std::lock_guard<std::mutex> lock(shard.mutex);
+
+	auto range = shard.tasks.equal_range(taskId);
+	for (auto task = range.first; task != range.second; task++)
+	{
+		task->second->cancel();
+	}
+}
+
+// -----------------------------------------------------------------
+//
+// @details Runs body over the indices [begin, end), spreading the work
+// over any idle workers.  The body is given a [first, last) range at a
+// time, no larger than the grain.  A grain of zero picks one that gives
+// each active worker several pieces, so that a worker that gets behind
+// doesn't hold everyone else up.  Called from outside the pool, the body
+// is simply run over the whole range on the calling thread.
+//
+// -----------------------------------------------------------------
+void ThreadPool::parallelFor(std::size_t begin, std::size_t end, std::size_t grain, ParallelForBody body)
+{
+	if (begin >= end)
+	{
+		return;
+	}
+
+	auto worker = WorkerThread::current();
+	if (worker == nullptr || &worker->getPool() != this)
+	{
+		body(begin, end);
+		return;
+	}
+
+	if (grain == 0)
+	{
+		grain = std::max(std::size_t{ 1 }, (end - begin) / (PIECES_PER_WORKER * m_active.load()));
+	}
+	worker->runRange(body, grain, begin, end);
+}
+
+// -----------------------------------------------------------------
+//
+// @details Places the task on the work queue of one of the workers.  A
+// task enqueued by a worker, as part of running some other task, goes on
+// that worker's own deque.  Otherwise it is handed to the workers in turn.
+// High priority tasks go the same way, but on the workers' urgent tier.  If
+// any workers are parked, one of them is woken.
+//
+// -----------------------------------------------------------------
+void ThreadPool::queueTask(Tasks::Task* task)
+{
+	task->setTimeQueued(std::chrono::high_resolution_clock::now());
+
+	auto worker = WorkerThread::current();
+	auto own = worker != nullptr && &worker->getPool() == this;
+	if (task->getPriority() == Tasks::Priority::High)
+	{
+		//
+		// Counted first, so the count never drops below the number queued
+		m_urgentCount.fetch_add(1, std::memory_order_relaxed);
+		if (own)
+		{
+			worker->pushUrgent(task);
+		}
+		else
+		{
+			auto next = m_nextInbox.fetch_add(1, std::memory_order_relaxed);
+			m_threads[next % m_active.load()]->deliverUrgent(task);
+		}
+	}
+	else if (own)
+	{
+		worker->push(task);
+	}
+	else
+	{
+		auto next = m_nextInbox.fetch_add(1, std::memory_order_relaxed);
+		m_threads[next % m_active.load()]->deliver(task);
+	}
+
+	wakeOne();
+}
+
+// -----------------------------------------------------------------
+//
+// @details Called by a worker when the task it was running suspended
+// itself.  The task goes back on the work queue, on the worker's own
+// deque, so it is the first thing picked up once the urgent tasks it gave
+// way to have been started.
+//
+// -----------------------------------------------------------------
+void ThreadPool::resumeTask(Tasks::Task* task)
+{
+	task->resume();
+	queueTask(task);
+}
+
+// -----------------------------------------------------------------
+//
+// @details Takes a high priority task, if there is one, from the taker's
+// own urgent tier first and otherwise from another worker's.  When there
+// isn't one, which is nearly always, this doesn't look at any queues.
+//
+// -----------------------------------------------------------------
+boost::optional<Tasks::Task*> ThreadPool::takeUrgent(uint16_t taker, std::minstd_rand& random)
+{
+	if (m_urgentCount.load(std::memory_order_relaxed) == 0)
+	{
+		return boost::none;
+	}
+
+	auto task = takeOwnUrgent(taker);
+	if (task == boost::none)
+	{
+		task = sweep<Tasks::Task*>(taker, random, [](WorkerThread& victim) { return victim.stealUrgent(); });
+		if (task != boost::none)
+		{
+			m_urgentCount.fetch_sub(1, std::memory_order_relaxed);
+		}
+	}
+
+	return task;
+}
+
+// -----------------------------------------------------------------
+//
+// @details Takes a high priority task from the taker's own urgent tier,
+// without trying any of the other workers.
+//
+// -----------------------------------------------------------------
+boost::optional<Tasks::Task*> ThreadPool::takeOwnUrgent(uint16_t taker)
+{
+	auto task = m_threads[taker]->findOwnUrgent();
+	if (task != boost::none)
+	{
+		m_urgentCount.fetch_sub(1, std::memory_order_relaxed);
+	}
+
+	return task;
+}
+
+// -----------------------------------------------------------------
+//
+// @details Called by a worker that has run out of its own work, to take
+// a task from one of the others.
+//
+// -----------------------------------------------------------------
+boost::optional<Tasks::Task*> ThreadPool::steal(uint16_t thief, std::minstd_rand& random)
+{
+	return sweep<Tasks::Task*>(thief, random, [](WorkerThread& victim) { return victim.steal(); });
+}
+
+// -----------------------------------------------------------------
+//
+// @details Takes a piece of some other worker's parallel for loop.
+//
+// -----------------------------------------------------------------
+boost::optional<ParallelForJob*> ThreadPool::stealJob(uint16_t thief, std::minstd_rand& random)
+{
+	return sweep<ParallelForJob*>(thief, random, [](WorkerThread& victim) { return victim.stealJob(); });
+}
+
+// -----------------------------------------------------------------
+//
+// @details Called by a worker once it is done with a task, whether it
+// was completed or cancelled.  This is the last reference the pool holds
+// to the task.
+//
+// -----------------------------------------------------------------
+void ThreadPool::finishTask(Tasks::Task* task)
+{
+	auto& shard = getShard(task->getId());
+	std::lock_guard<std::mutex> lock(shard.mutex);
+
+	//
+	// The same task id can be here more than once, when the client retries a
+	// task on the same server it first sent it to.
+	auto range = shard.tasks.equal_range(task->getId());
+	for (auto entry = range.first; entry != range.second; entry++)
+	{
+		if (entry->second.get() == task)
+		{
+			shard.tasks.erase(entry);
+			break;
+		}
+	}
+}
+
+// -----------------------------------------------------------------
+//
+// @details Decides where each worker runs.  The cores are taken one from
+// each node in turn, so that the lowest numbered workers, the ones active
+// when the pool is small, are spread evenly over the nodes, and the first
+// worker for each core lands on a different core.  Once there are more
+// workers than cores, the cores are reused in the same order.
+//
+// -----------------------------------------------------------------
+void ThreadPool::place(Placement placement)
+{
+	auto topology = Topology::instance();
+	auto& nodes = topology->getNodes();
+
+	std::vector<std::pair<std::size_t, uint16_t>> cores;	// Node index, cpu
+	for (std::size_t round = 0; cores.size() < topology->getCpuCount(); round++)
+	{
+		for (std::size_t node = 0; node < nodes.size(); node++)
+		{
+			if (round < nodes[node].cpus.size())
+			{
+				cores.push_back(std::make_pair(node, nodes[node].cpus[round]));
+			}
+		}
+	}
+
+	for (std::size_t index = 0; index < m_threads.size(); index++)
+	{
+		auto& core = cores[index % cores.size()];
+		if (placement == Placement::Core)
+		{
+			m_threads[index]->place(static_cast<uint16_t>(core.first), { core.second });
+		}
+		else
+		{
+			m_threads[index]->place(static_cast<uint16_t>(core.first), nodes[core.first].cpus);
+		}
+	}
+	m_nodeCount = nodes.size();
+}
+
+// -----------------------------------------------------------------
+//
+// @details Adds the worker to the parked list.  The worker must look for
+// work once more after this, anything enqueued before the worker was on
+// the list didn't try to wake it.
+//
+// -----------------------------------------------------------------
+void ThreadPool::park(WorkerThread* worker)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutexParked);
+		m_parked.push_back(worker);
+		m_parkedCount.fetch_add(1, std::memory_order_seq_cst);
+	}
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+// -----------------------------------------------------------------
+//
+// @details Takes the worker off the parked list, used when it found
+// work after all.  If it is no longer on the list, it has already been
+// woken.
+//
+// -----------------------------------------------------------------
+void ThreadPool::unpark(WorkerThread* worker)
+{
+	std::lock_guard<std::mutex> lock(m_mutexParked);
+
+	auto position = std::find(m_parked.begin(), m_parked.end(), worker);
+	if (position != m_parked.end())
+	{
+		m_parked.erase(position);
+		m_parkedCount.fetch_sub(1, std::memory_order_seq_cst);
+	}
+}
+
+// -----------------------------------------------------------------
+//
+// @details Wakes a single parked worker, if there are any.  When nobody
+// is parked, which is the case whenever the pool is busy, this doesn't
+// take any locks.
+//
+// -----------------------------------------------------------------
+void ThreadPool::wakeOne()
+{
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (m_parkedCount.load(std::memory_order_seq_cst) == 0)
+	{
+		return;
+	}
+
+	WorkerThread* worker = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(m_mutexParked);
+		if (!m_parked.empty())
+		{
+			worker = m_parked.back();
+			m_parked.pop_back();
+			m_parkedCount.fetch_sub(1, std::memory_order_seq_cst);
+		}
+	}
+	if (worker != nullptr)
+	{
+		worker->wake();
+	}
+}
+
+// -----------------------------------------------------------------
+//
+// @details This is the entry point for the thread that adjusts the size
+// of the pool.  Every interval it compares a new sample of the worker
+// totals against the previous one and resizes the pool to suit.
+//
+// -----------------------------------------------------------------
+void ThreadPool::controlSize()
+{
+	auto previous = takeSample();
+	while (!m_done)
+	{
+		std::this_thread::sleep_for(SIZE_INTERVAL);
+
+		auto current = takeSample();
+		auto size = getTargetSize(previous, current);
+		if (size != m_active.load())
+		{
+			resize(size);
+		}
+		previous = current;
+	}
+}
+
+// -----------------------------------------------------------------
+//
+// @details Adds up the totals from all of the workers, along with the
+// CPU time used by the whole process.
+//
+// -----------------------------------------------------------------
+ThreadPool::Sample ThreadPool::takeSample()
+{
+	auto sample = Sample{};
+	sample.time = std::chrono::high_resolution_clock::now();
+
+	auto cpu = boost::chrono::process_cpu_clock::now().time_since_epoch().count();
+	sample.processCpu = static_cast<uint64_t>(cpu.user + cpu.system);
+
+	for (auto& worker : m_threads)
+	{
+		auto stats = worker->getStats();
+		sample.workers.started += stats.started;
+		sample.workers.waitTime += stats.waitTime;
+		sample.workers.busyTime += stats.busyTime;
+		sample.workers.cpuTime += stats.cpuTime;
+		sample.workers.idleTime += stats.idleTime;
+		sample.workers.stolen += stats.stolen;
+	}
+
+	return sample;
+}
+
+// -----------------------------------------------------------------
+//
+// @details Decides how many workers should be active, based upon what
+// happened between the two samples.
+//   * When work is waiting and cores are going unused, the workers must be
+//     blocked.  Enough workers are added to cover the time they spend
+//     blocked, but no more than doubling at a time.
+//   * When the CPU is saturated and there are more workers than cores, the
+//     extra workers are only taking turns on the cores, so one is retired.
+//   * When nothing is waiting and the workers are mostly parked, one is
+//     retired.
+//
+// -----------------------------------------------------------------
+uint16_t ThreadPool::getTargetSize(const Sample& previous, const Sample& current)
+{
+	auto interval = std::chrono::duration_cast<std::chrono::nanoseconds>(current.time - previous.time).count();
+	auto cores = std::max(1u, std::thread::hardware_concurrency());
+	auto active = m_active.load();
+	if (interval <= 0)
+	{
+		return active;
+	}
+
+	auto started = current.workers.started - previous.workers.started;
+	auto waitTime = current.workers.waitTime - previous.workers.waitTime;
+	auto busyTime = current.workers.busyTime - previous.workers.busyTime;
+	auto cpuTime = current.workers.cpuTime - previous.workers.cpuTime;
+	auto idleTime = current.workers.idleTime - previous.workers.idleTime;
 	//
-	// Notify a thread something was added to the queue
-	std::unique_lock<std::mutex> lock(m_mutexWorkQueue);
-	m_eventWorkQueue.notify_one();
+	// Number of cores the process kept busy, and the fraction of the time
+	// tasks spent blocked instead of using a core.
+	auto coresUsed = static_cast<double>(current.processCpu - previous.processCpu) / interval;
+	auto blocked = busyTime > 0 ? 1.0 - static_cast<double>(cpuTime) / busyTime : 0.0;
+	blocked = std::min(std::max(blocked, 0.0), 0.9);
+	auto idle = static_cast<double>(idleTime) / (static_cast<double>(interval) * active);
+
+	auto waiting = countPending() > 0 ||
+		(started > 0 && std::chrono::nanoseconds(waitTime / started) > WAIT_THRESHOLD);
+
+	auto size = static_cast<uint32_t>(active);
+	if (waiting && coresUsed < cores * CPU_ROOM)
+	{
+		//
+		// If no task finished during the interval there is nothing to go on for
+		// how blocked they are, so just fill the unused cores.
+		auto needed = busyTime > 0 ?
+			static_cast<uint32_t>(std::ceil(cores / (1.0 - blocked))) :
+			static_cast<uint32_t>(active + std::ceil(cores - coresUsed));
+		size = std::max(size + 1, std::min(needed, size * 2));
+	}
+	else if (coresUsed >= cores * CPU_SATURATED && active > cores)
+	{
+		size = active - 1;
+	}
+	else if (!waiting && idle > IDLE_THRESHOLD)
+	{
+		size = active - 1;
+	}
+
+	return static_cast<uint16_t>(std::min(std::max(size, static_cast<uint32_t>(m_sizeMinimum)), static_cast<uint32_t>(m_sizeMaximum)));
+}
+
+// -----------------------------------------------------------------
+//
+// @details Returns the number of tasks waiting to be started.
+//
+// -----------------------------------------------------------------
+std::size_t ThreadPool::countPending()
+{
+	auto tasks = std::size_t{ 0 };
+	for (auto& shard : m_tasks)
+	{
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		tasks += shard.tasks.size();
+	}
+
+	auto running = std::size_t{ 0 };
+	for (auto& worker : m_threads)
+	{
+		if (worker->isRunningTask())
+		{
+			running++;
+		}
+	}
+
+	return tasks > running ? tasks - running : 0;
+}
+
+// -----------------------------------------------------------------
+//
+// @details Changes the number of active workers.  Newly active workers are
+// started or woken.  Workers no longer active notice on their own and
+// retire once they finish what they are doing.
+//
+// -----------------------------------------------------------------
+void ThreadPool::resize(uint16_t size)
+{
+	auto active = m_active.load();
+	if (size > active)
+	{
+		//
+		// Workers have to be counted as started before they can be given work,
+		// otherwise the others won't try to steal from them.
+		m_started = std::max(m_started.load(), size);
+		m_active = size;
+		for (auto index = active; index < size; index++)
+		{
+			if (!m_threads[index]->isStarted())
+			{
+				m_threads[index]->start();
+			}
+			else
+			{
+				m_threads[index]->wake();
+			}
+		}
+	}
+	else
+	{
+		m_active = size;
+	}
 }
 
 // -----------------------------------------------------------------
@@ -65,23 +623,27 @@ void ThreadPool::terminate()
 	if (m_instance != nullptr)
 	{
 		//
-		// Tell each of the workers threads in the waiting queue to terminate
+		// Stop resizing first, so the set of started workers doesn't change
+		m_instance->m_done = true;
+		m_instance->m_controller->join();
+
+		//
+		// Tell each of the workers threads to terminate, waking any that are
+		// parked or retired so they see they are finished.
 		for (auto thread : m_instance->m_threads)
 		{
 			thread->terminate();
+			thread->wake();
 		}
 
-		//
-		// Signal the event so that any non-working threads will wake up and see they are
-		// finished.
-		std::unique_lock<std::mutex> lock(m_instance->m_mutexWorkQueue);
-		m_instance->m_eventWorkQueue.notify_all();
-
 		//
 		// Wait for all the threads to complete
 		for (auto thread : m_instance->m_threads)
 		{
-			thread->join();
+			if (thread->isStarted())
+			{
+				thread->join();
+			}
 		}
 
 		//
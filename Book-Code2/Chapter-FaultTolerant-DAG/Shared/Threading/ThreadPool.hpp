@@ -5,10 +5,14 @@
 #include "Shared/Tasks/Task.hpp"
 #include "WorkerThread.hpp"
 
-#include <condition_variable>
+#include <array>
+#include <atomic>
+#include <functional>
 #include <memory>
 #include <mutex>
-#include <set>
+#include <random>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
 //
@@ -27,29 +31,165 @@ namespace ip = boost::asio::ip;
 // be used to create & manage worker threads that handle all tasks throughout
 // the system.
 //
+// There is no central work queue.  Each worker has its own deque of tasks,
+// along with an inbox for tasks handed to it by threads outside the pool.
+// A worker that runs out of work steals from the other workers, starting
+// with one chosen at random.  A worker that can't find anything to steal
+// parks itself, and new work only wakes as many parked workers as needed.
+//
+// The number of active workers is adjusted as the pool runs, between the
+// bounds given to .configure.  Every so often the pool looks at how long
+// tasks are waiting to start, how much of the time running tasks spend
+// blocked rather than using the CPU, how idle the workers are, and how
+// much CPU the process is using.  Workers are added when work is waiting
+// while cores go unused, and removed when the CPU is oversubscribed or the
+// workers sit idle.
+//
+// Optionally, the workers can be pinned, either each to a single core or
+// each to all of the cores of a NUMA node.  Workers are spread across the
+// nodes in turn, so that however many are active, the nodes share them
+// evenly.  The workers on a node form that node's run queue: a worker out
+// of work steals from the others on its node before going to other nodes,
+// which keeps tasks, and the memory they allocate, on one node.
+//
+// A task can spread its own work over idle workers with .parallelFor, which
+// splits a range of indices recursively, fork/join style.  The worker that
+// calls it doesn't return until the whole range is done, but helps with the
+// work rather than blocking while it waits.
+//
+// High priority tasks go on a tier of the workers' queues of their own,
+// which every worker checks, its own and then by stealing, before anything
+// else.  Only a count of them is shared by the whole pool.  While one is
+// waiting, other tasks that check .shouldYield give up their workers, to
+// be picked up again once the high priority tasks have been started.
+//
 // -----------------------------------------------------------------
 class ThreadPool
 {
 public:
+	enum class Placement
+	{
+		None,		// Leave the workers to the operating system
+		Core,		// Pin each worker to one core
+		Node		// Pin each worker to the cores of one NUMA node
+	};
+
 	static std::shared_ptr<ThreadPool> instance();
+	static void configure(uint16_t sizeMinimum, uint16_t sizeMaximum, Placement placement = Placement::None);
 
 	void initialize(boost::asio::io_service* ioService) { m_ioService = ioService; }
 	void enqueueTask(std::shared_ptr<Tasks::Task> task);
+	void cancelTask(uint64_t taskId);
+	void parallelFor(std::size_t begin, std::size_t end, std::size_t grain, ParallelForBody body);
+	bool hasUrgentWork() { return m_urgentCount.load(std::memory_order_relaxed) != 0; }
+	WorkerThread::Stats getStats()	{ return takeSample().workers; }
 	boost::asio::io_service* getIOService() { return m_ioService; }
 
 	static void terminate();
 
 protected:
-	ThreadPool(uint16_t sizeInitial);
+	ThreadPool(uint16_t sizeMinimum, uint16_t sizeInitial, uint16_t sizeMaximum, Placement placement);
 
 private:
+	friend class WorkerThread;
+
 	static std::shared_ptr<ThreadPool> m_instance;
+	static const std::size_t TASK_SHARDS = 16;
+	static uint16_t m_configMinimum;			// Zero until .configure is called
+	static uint16_t m_configMaximum;
+	static Placement m_configPlacement;
 	boost::asio::io_service* m_ioService;
 
-	std::set<std::shared_ptr<WorkerThread>> m_threads;
-	ConcurrentQueue<std::shared_ptr<Tasks::Task>> m_workQueue;
-	std::condition_variable m_eventWorkQueue;
-	std::mutex m_mutexWorkQueue;
+	std::vector<std::shared_ptr<WorkerThread>> m_threads;	// Enough for the maximum size, only some are running
+	std::atomic<uint16_t> m_active;				// Workers [0, m_active) take on new work
+	std::atomic<uint16_t> m_started;			// Workers [0, m_started) have a running thread
+	uint16_t m_sizeMinimum;
+	uint16_t m_sizeMaximum;
+	std::atomic<uint32_t> m_nextInbox;			// Round robin of workers given outside tasks
+	std::atomic<uint32_t> m_urgentCount;		// High priority tasks queued on any of the workers
+	std::size_t m_nodeCount;					// Number of nodes the workers are spread across
+
+	std::atomic<bool> m_done;
+	std::shared_ptr<std::thread> m_controller;	// Periodically adjusts m_active
+
+	std::vector<WorkerThread*> m_parked;		// Workers waiting for something to do
+	std::atomic<uint32_t> m_parkedCount;		// Size of m_parked, readable without the lock
+	std::mutex m_mutexParked;
+
+	//
+	// Every task queued or running, by task id, so they can be found to be
+	// cancelled.  This also keeps the tasks alive while the worker queues
+	// refer to them.  Spread over several maps to keep the locks apart.
+	struct TaskShard
+	{
+		std::unordered_multimap<uint64_t, std::shared_ptr<Tasks::Task>> tasks;
+		std::mutex mutex;
+	};
+	std::array<TaskShard, TASK_SHARDS> m_tasks;
+
+	//
+	// Totals from all of the workers, used to find the change over a period
+	struct Sample
+	{
+		std::chrono::high_resolution_clock::time_point time;
+		uint64_t processCpu;		// Nanoseconds
+		WorkerThread::Stats workers;
+	};
+
+	bool isActive(uint16_t index) { return index < m_active.load(); }
+	void queueTask(Tasks::Task* task);
+	void resumeTask(Tasks::Task* task);
+	boost::optional<Tasks::Task*> takeUrgent(uint16_t taker, std::minstd_rand& random);
+	boost::optional<Tasks::Task*> takeOwnUrgent(uint16_t taker);
+	boost::optional<Tasks::Task*> steal(uint16_t thief, std::minstd_rand& random);
+	boost::optional<ParallelForJob*> stealJob(uint16_t thief, std::minstd_rand& random);
+	template <typename T>
+	boost::optional<T> sweep(uint16_t thief, std::minstd_rand& random, std::function<boost::optional<T> (WorkerThread&)> take);
+	void finishTask(Tasks::Task* task);
+	void place(Placement placement);
+	void park(WorkerThread* worker);
+	void unpark(WorkerThread* worker);
+	void wakeOne();
+	void controlSize();
+	Sample takeSample();
+	uint16_t getTargetSize(const Sample& previous, const Sample& current);
+	std::size_t countPending();
+	void resize(uint16_t size);
+	TaskShard& getShard(uint64_t taskId) { return m_tasks[taskId % TASK_SHARDS]; }
 };
 
+// -----------------------------------------------------------------
+//
+// @details Tries the other workers in order, starting from one at random so
+// the thieves spread out rather than all going after the same worker.
+// Retired workers are included, they may have been handed a task just as
+// they were retired.  Workers on the thief's own node are tried before
+// those on any other node.
+//
+// -----------------------------------------------------------------
+template <typename T>
+boost::optional<T> ThreadPool::sweep(uint16_t thief, std::minstd_rand& random, std::function<boost::optional<T> (WorkerThread&)> take)
+{
+	boost::optional<T> item = boost::none;
+
+	auto count = static_cast<std::size_t>(m_started.load());
+	auto start = random() % count;
+	auto node = m_threads[thief]->getNode();
+	auto passes = m_nodeCount > 1 ? 2 : 1;
+	for (auto pass = 0; pass < passes && item == boost::none; pass++)
+	{
+		for (std::size_t offset = 0; offset < count && item == boost::none; offset++)
+		{
+			auto victim = (start + offset) % count;
+			auto local = m_threads[victim]->getNode() == node;
+			if (victim != thief && local == (pass == 0))
+			{
+				item = take(*m_threads[victim]);
+			}
+		}
+	}
+
+	return item;
+}
+
 #endif // _THREADPOOL_HPP_
@@ -0,0 +1,195 @@
+#include "Topology.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+std::shared_ptr<Topology> Topology::m_instance = nullptr;
+
+namespace
+{
+	// -----------------------------------------------------------------
+	//
+	// @details Returns the first line of the file, or an empty string if
+	// it can't be read.
+	//
+	// -----------------------------------------------------------------
+	std::string readLine(const std::string& path)
+	{
+		auto line = std::string{};
+		std::ifstream file(path);
+		if (file)
+		{
+			std::getline(file, line);
+		}
+
+		return line;
+	}
+
+	// -----------------------------------------------------------------
+	//
+	// @details Removes any CPUs the process isn't allowed to run on, such as
+	// those outside of a container's cpuset.
+	//
+	// -----------------------------------------------------------------
+	std::vector<uint16_t> filterAllowed(const std::vector<uint16_t>& cpus)
+	{
+#if defined(__linux__)
+		cpu_set_t allowed;
+		CPU_ZERO(&allowed);
+		if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0)
+		{
+			auto filtered = std::vector<uint16_t>{};
+			for (auto cpu : cpus)
+			{
+				if (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed))
+				{
+					filtered.push_back(cpu);
+				}
+			}
+			return filtered;
+		}
+#endif
+		return cpus;
+	}
+}
+
+// -----------------------------------------------------------------
+//
+// @details This is the Singleton 'instance' accessor
+//
+// -----------------------------------------------------------------
+std::shared_ptr<Topology> Topology::instance()
+{
+	if (m_instance)		return m_instance;
+
+	m_instance = std::shared_ptr<Topology>(new Topology());
+
+	return m_instance;
+}
+
+// -----------------------------------------------------------------
+//
+// @details The constructor reads the layout of the machine.  If nothing
+// useful is found, all of the cores are put into a single node.
+//
+// -----------------------------------------------------------------
+Topology::Topology()
+{
+	readNodes();
+
+	if (m_nodes.empty())
+	{
+		auto node = Node{ 0, {} };
+		node.cpus = filterAllowed(parseCpuList(readLine("/sys/devices/system/cpu/online")));
+		if (node.cpus.empty())
+		{
+			for (auto cpu = 0u; cpu < std::max(1u, std::thread::hardware_concurrency()); cpu++)
+			{
+				node.cpus.push_back(static_cast<uint16_t>(cpu));
+			}
+		}
+		m_nodes.push_back(node);
+	}
+}
+
+// -----------------------------------------------------------------
+//
+// @details Returns the total number of CPUs over all of the nodes.
+//
+// -----------------------------------------------------------------
+std::size_t Topology::getCpuCount()
+{
+	auto count = std::size_t{ 0 };
+	for (auto& node : m_nodes)
+	{
+		count += node.cpus.size();
+	}
+
+	return count;
+}
+
+// -----------------------------------------------------------------
+//
+// @details Restricts the calling thread to the given CPUs.  Returns false
+// if that isn't supported here or the operating system refused.
+//
+// -----------------------------------------------------------------
+bool Topology::pinCurrentThread(const std::vector<uint16_t>& cpus)
+{
+#if defined(__linux__)
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	for (auto cpu : cpus)
+	{
+		if (cpu < CPU_SETSIZE)
+		{
+			CPU_SET(cpu, &set);
+		}
+	}
+
+	return !cpus.empty() && pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+	return false;
+#endif
+}
+
+// -----------------------------------------------------------------
+//
+// @details Reads the online NUMA nodes and the CPUs belonging to each.
+// Nodes without any CPUs the process can use, such as memory only nodes,
+// are left out.
+//
+// -----------------------------------------------------------------
+void Topology::readNodes()
+{
+#if defined(__linux__)
+	for (auto id : parseCpuList(readLine("/sys/devices/system/node/online")))
+	{
+		auto node = Node{ id, {} };
+		node.cpus = filterAllowed(parseCpuList(readLine("/sys/devices/system/node/node" + std::to_string(id) + "/cpulist")));
+		if (!node.cpus.empty())
+		{
+			m_nodes.push_back(node);
+		}
+	}
+#endif
+}
+
+// -----------------------------------------------------------------
+//
+// @details Parses the list format used throughout /sys, such as "0-3,8-11".
+// Anything that doesn't parse is skipped.
+//
+// -----------------------------------------------------------------
+std::vector<uint16_t> Topology::parseCpuList(const std::string& list)
+{
+	auto cpus = std::vector<uint16_t>{};
+
+	std::istringstream stream(list);
+	auto range = std::string{};
+	while (std::getline(stream, range, ','))
+	{
+		try
+		{
+			auto dash = range.find('-');
+			auto first = std::stoul(range.substr(0, dash));
+			auto last = dash == std::string::npos ? first : std::stoul(range.substr(dash + 1));
+			for (auto cpu = first; cpu <= last && cpu <= UINT16_MAX; cpu++)
+			{
+				cpus.push_back(static_cast<uint16_t>(cpu));
+			}
+		}
+		catch (std::exception&)
+		{
+		}
+	}
+
+	return cpus;
+}
@@ -0,0 +1,50 @@
+#ifndef _TOPOLOGY_HPP_
+#define _TOPOLOGY_HPP_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// -----------------------------------------------------------------
+//
+// @details Describes the CPUs available to the process and how they are
+// grouped into NUMA nodes.  On Linux this is read from /sys/devices/system,
+// limited to the CPUs the process is allowed to run on.  Anywhere else, or
+// if that information can't be read, the machine is described as a single
+// node holding every core.
+//
+// Memory on Linux is placed on the node of the thread that first touches
+// it, so a thread pinned to a node that allocates and fills its own
+// buffers gets node-local memory without any special allocator.
+//
+// -----------------------------------------------------------------
+class Topology
+{
+public:
+	struct Node
+	{
+		uint16_t id;
+		std::vector<uint16_t> cpus;
+	};
+
+	static std::shared_ptr<Topology> instance();
+
+	const std::vector<Node>& getNodes()	{ return m_nodes; }
+	std::size_t getCpuCount();
+
+	static bool pinCurrentThread(const std::vector<uint16_t>& cpus);
+
+protected:
+	Topology();
+
+private:
+	static std::shared_ptr<Topology> m_instance;
+
+	std::vector<Node> m_nodes;
+
+	void readNodes();
+	static std::vector<uint16_t> parseCpuList(const std::string& list);
+};
+
+#endif // _TOPOLOGY_HPP_
@@ -0,0 +1,176 @@
+#ifndef _WORKSTEALINGDEQUE_HPP_
+#define _WORKSTEALINGDEQUE_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <boost/optional.hpp>
+
+// ------------------------------------------------------------------
+//
+// @details This is a Chase-Lev work stealing deque.  A single thread, the
+// owner, pushes and pops items at the bottom of the deque, while any number
+// of other threads steal items from the top.  None of the operations take a
+// lock; the owner and a thief only contend when there is one item left.
+//
+// The items are kept in a circular array that grows when full.  The old
+// arrays are kept around until the deque is destroyed, because a thief may
+// still be reading from one of them.  Growth doubles the size, so this never
+// amounts to more than the size of the current array.
+//
+// ------------------------------------------------------------------
+template <typename T>	// T must be a pointer
+class WorkStealingDeque
+{
+public:
+	WorkStealingDeque() :
+		m_top(0),
+		m_bottom(0)
+	{
+		m_arrays.push_back(std::unique_ptr<Array>(new Array(INITIAL_CAPACITY)));
+		m_array = m_arrays.back().get();
+	}
+
+	// ------------------------------------------------------------------
+	//
+	// @details Adds an item to the bottom of the deque.  Only the owner
+	// may call this.
+	//
+	// ------------------------------------------------------------------
+	void push(T item)
+	{
+		auto bottom = m_bottom.load(std::memory_order_relaxed);
+		auto top = m_top.load(std::memory_order_acquire);
+		auto array = m_array.load(std::memory_order_relaxed);
+		if (bottom - top > static_cast<int64_t>(array->capacity) - 1)
+		{
+			array = grow(array, top, bottom);
+		}
+		array->put(bottom, item);
+		//
+		// The release store is more than the fence needs, but it lets thread
+		// sanitizers, which don't understand fences, see the item is published.
+		std::atomic_thread_fence(std::memory_order_release);
+		m_bottom.store(bottom + 1, std::memory_order_release);
+	}
+
+	// ------------------------------------------------------------------
+	//
+	// @details Removes the item at the bottom of the deque, the one most
+	// recently pushed.  Only the owner may call this.
+	//
+	// ------------------------------------------------------------------
+	boost::optional<T> pop()
+	{
+		boost::optional<T> item = boost::none;
+
+		auto bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+		auto array = m_array.load(std::memory_order_relaxed);
+		m_bottom.store(bottom, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		auto top = m_top.load(std::memory_order_relaxed);
+		if (top <= bottom)
+		{
+			item = array->get(bottom);
+			if (top == bottom)
+			{
+				//
+				// Last item, race any thieves for it
+				if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+				{
+					item = boost::none;
+				}
+				m_bottom.store(bottom + 1, std::memory_order_relaxed);
+			}
+		}
+		else
+		{
+			m_bottom.store(bottom + 1, std::memory_order_relaxed);
+		}
+
+		return item;
+	}
+
+	// ------------------------------------------------------------------
+	//
+	// @details Removes the item at the top of the deque, the one pushed the
+	// longest ago.  May be called from any thread.  Returns nothing when the
+	// deque is empty or another thread got to the item first.
+	//
+	// ------------------------------------------------------------------
+	boost::optional<T> steal()
+	{
+		boost::optional<T> item = boost::none;
+
+		auto top = m_top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		auto bottom = m_bottom.load(std::memory_order_acquire);
+		if (top < bottom)
+		{
+			auto array = m_array.load(std::memory_order_acquire);
+			auto candidate = array->get(top);
+			if (m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			{
+				item = candidate;
+			}
+		}
+
+		return item;
+	}
+
+	// ------------------------------------------------------------------
+	//
+	// @details A snapshot only, the deque may change before this returns.
+	//
+	// ------------------------------------------------------------------
+	bool empty()
+	{
+		return m_bottom.load(std::memory_order_relaxed) <= m_top.load(std::memory_order_relaxed);
+	}
+
+private:
+	static const std::size_t INITIAL_CAPACITY = 64;
+
+	struct Array
+	{
+		Array(std::size_t capacity) :
+			capacity(capacity),
+			items(new std::atomic<T>[capacity])
+		{
+		}
+
+		T get(int64_t index)				{ return items[index & (capacity - 1)].load(std::memory_order_relaxed); }
+		void put(int64_t index, T item)		{ items[index & (capacity - 1)].store(item, std::memory_order_relaxed); }
+
+		std::size_t capacity;				// Always a power of two
+		std::unique_ptr<std::atomic<T>[]> items;
+	};
+
+	std::atomic<int64_t> m_top;
+	std::atomic<int64_t> m_bottom;
+	std::atomic<Array*> m_array;
+	std::vector<std::unique_ptr<Array>> m_arrays;		// Every array used, only touched by the owner
+
+	// ------------------------------------------------------------------
+	//
+	// @details Replaces the array with one twice the size, copying over the
+	// items currently in the deque.
+	//
+	// ------------------------------------------------------------------
+	Array* grow(Array* array, int64_t top, int64_t bottom)
+	{
+		m_arrays.push_back(std::unique_ptr<Array>(new Array(array->capacity * 2)));
+		auto bigger = m_arrays.back().get();
+		for (auto index = top; index < bottom; index++)
+		{
+			bigger->put(index, array->get(index));
+		}
+		m_array.store(bigger, std::memory_order_release);
+
+		return bigger;
+	}
+};
+
+#endif // _WORKSTEALINGDEQUE_HPP_
@@ -1,22 +1,65 @@
 #include "WorkerThread.hpp"
 #include "ThreadPool.hpp"
+#include "Topology.hpp"
 #include "Shared/TaskStatusTool.hpp"
 
+#include <algorithm>
+#include <chrono>
 #include <mutex>
 
+#include <boost/chrono/thread_clock.hpp>
+
+namespace
+{
+	//
+	// The worker running on this thread, if any
+	thread_local WorkerThread* currentWorker = nullptr;
+}
+
 // ------------------------------------------------------------------
 //
-// @details This constructor gets the underlying thread created
-// along with saving references to the work queue, work queue event,
-// and the number of available threads counter.
+// @details This constructor saves a reference to the pool the worker
+// belongs to, along with its position in that pool.  The underlying
+// thread isn't created until .start is called.
 //
 // ------------------------------------------------------------------
-WorkerThread::WorkerThread(ConcurrentQueue<std::shared_ptr<Tasks::Task>>& workQueue, std::condition_variable& eventWorkQueue, std::mutex& mutexWorkQueue) :
-	m_workQueue(workQueue),
-	m_eventWorkQueue(eventWorkQueue),
-	m_mutexWorkQueue(mutexWorkQueue),
+WorkerThread::WorkerThread(ThreadPool& pool, uint16_t index) :
+	m_thread(nullptr),
 	m_done(false),
-	m_thread(nullptr)
+	m_runningTask(false),
+	m_pool(pool),
+	m_index(index),
+	m_random(index + 1),
+	m_node(0),
+	m_signaled(false),
+	m_statsStarted(0),
+	m_statsWaitTime(0),
+	m_statsBusyTime(0),
+	m_statsCpuTime(0),
+	m_statsIdleTime(0),
+	m_statsStolen(0),
+	m_parkedSince(0)
+{
+}
+
+// ------------------------------------------------------------------
+//
+// @details Records the node the worker belongs to and the cores it is to
+// run on.  Must be called before .start.
+//
+// ------------------------------------------------------------------
+void WorkerThread::place(uint16_t node, std::vector<uint16_t> cpus)
+{
+	m_node = node;
+	m_cpus = std::move(cpus);
+}
+
+// ------------------------------------------------------------------
+//
+// @details Creates the underlying thread.
+//
+// ------------------------------------------------------------------
+void WorkerThread::start()
 {
 	m_thread = new std::thread(&WorkerThread::run, this);
 }
@@ -24,26 +67,50 @@ WorkerThread::WorkerThread(ConcurrentQueue<std::shared_ptr<Tasks::Task>>& workQu
 // ------------------------------------------------------------------
 //
 // @details This is the entry point method for the actual worker thread.  This
-// method stays running until we are asked to voluntarily terminate.  The
-// thread waits on a signal to check for something in the work queue.  If there
-// is something in the queue, it goes to work.
+// method stays running until we are asked to voluntarily terminate.  As long
+// as there is work to be found, the worker keeps at it; once there is none,
+// it parks until woken.  High priority tasks come first.  Helping with a
+// task that is already running comes before starting a task taken from
+// another worker.
 //
 // ------------------------------------------------------------------
 void WorkerThread::run()
 {
+	currentWorker = this;
+	if (!m_cpus.empty())
+	{
+		Topology::pinCurrentThread(m_cpus);
+	}
+
 	while (!m_done)
 	{
-		boost::optional<std::shared_ptr<Tasks::Task>> task = m_workQueue.dequeue();
+		if (!m_pool.isActive(m_index))
+		{
+			retire();
+			continue;
+		}
+
+		auto task = m_pool.takeUrgent(m_index, m_random);
+		if (task == boost::none)
+		{
+			task = findOwnTask();
+		}
+		if (task == boost::none)
+		{
+			if (helpParallelFor())
+			{
+				continue;
+			}
+			task = stealTask();
+		}
+
 		if (task != boost::none)
 		{
-			task.get()->execute();
-			task.get()->complete(*ThreadPool::instance()->getIOService());
-			TaskStatusTool::instance()->removeTask(task.get()->getId());
+			runTask(task.get());
 		}
 		else
 		{
-			std::unique_lock<std::mutex> lock(m_mutexWorkQueue);
-			m_eventWorkQueue.wait(lock);
+			park();
 		}
 	}
 }
@@ -69,3 +136,375 @@ void WorkerThread::join()
 {
 	m_thread->join();
 }
+
+// ------------------------------------------------------------------
+//
+// @details Called by other workers looking for something to do.  Takes
+// the oldest task from the deque, or failing that, from the inbox.
+//
+// ------------------------------------------------------------------
+boost::optional<Tasks::Task*> WorkerThread::steal()
+{
+	auto task = m_deque.steal();
+	if (task == boost::none)
+	{
+		task = m_inbox.dequeue();
+	}
+
+	return task;
+}
+
+// ------------------------------------------------------------------
+//
+// @details Called by other workers looking for a high priority task.
+//
+// ------------------------------------------------------------------
+boost::optional<Tasks::Task*> WorkerThread::stealUrgent()
+{
+	auto task = m_urgent.steal();
+	if (task == boost::none)
+	{
+		task = m_urgentInbox.dequeue();
+	}
+
+	return task;
+}
+
+// ------------------------------------------------------------------
+//
+// @details Takes the most recent high priority task given to this
+// worker.  Only the worker itself may call this.
+//
+// ------------------------------------------------------------------
+boost::optional<Tasks::Task*> WorkerThread::findOwnUrgent()
+{
+	auto task = m_urgent.pop();
+	if (task == boost::none)
+	{
+		task = m_urgentInbox.dequeue();
+	}
+
+	return task;
+}
+
+// ------------------------------------------------------------------
+//
+// @details Runs the body of a parallel for loop over [begin, end).  While
+// the range is larger than the grain, the upper half is split off as a job
+// and the lower half is kept.  After running the body over what is left,
+// the jobs that nobody stole are run here.  Until the stolen ones finish,
+// this worker helps with whatever other jobs it can find.
+//
+// ------------------------------------------------------------------
+void WorkerThread::runRange(const ParallelForBody& body, std::size_t grain, std::size_t begin, std::size_t end)
+{
+	//
+	// Halving each time, this is enough to split ranges up to 2^32 times the grain
+	std::array<ParallelForJob, 32> jobs;
+	std::atomic<uint32_t> pending(0);
+
+	auto count = std::size_t{ 0 };
+	while (end - begin > grain && count < jobs.size())
+	{
+		auto middle = begin + (end - begin) / 2;
+		jobs[count] = ParallelForJob{ &body, grain, middle, end, &pending };
+		pending++;
+		m_jobs.push(&jobs[count++]);
+		m_pool.wakeOne();
+		end = middle;
+	}
+
+	body(begin, end);
+
+	while (pending.load(std::memory_order_acquire) != 0)
+	{
+		//
+		// If our own jobs were stolen, this may find one belonging to an
+		// enclosing range, or another worker's, which is just as useful.
+		auto job = m_jobs.pop();
+		if (job == boost::none)
+		{
+			job = m_pool.stealJob(m_index, m_random);
+		}
+
+		if (job != boost::none)
+		{
+			runJob(job.get());
+		}
+		else
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+// ------------------------------------------------------------------
+//
+// @details Returns a snapshot of the running totals for this worker.  If
+// the worker is parked right now, the time so far is counted as idle.
+//
+// ------------------------------------------------------------------
+WorkerThread::Stats WorkerThread::getStats()
+{
+	auto stats = Stats{ m_statsStarted, m_statsWaitTime, m_statsBusyTime, m_statsCpuTime, m_statsIdleTime, m_statsStolen };
+
+	auto parkedSince = m_parkedSince.load();
+	if (parkedSince != 0)
+	{
+		auto now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now().time_since_epoch()).count();
+		stats.idleTime += static_cast<uint64_t>(std::max(now - parkedSince, int64_t{ 0 }));
+	}
+
+	return stats;
+}
+
+// ------------------------------------------------------------------
+//
+// @details Wakes the worker if it is parked.  If it isn't, the next time
+// it parks it returns right away and looks for work again.
+//
+// ------------------------------------------------------------------
+void WorkerThread::wake()
+{
+	std::lock_guard<std::mutex> lock(m_mutexPark);
+
+	m_signaled = true;
+	m_eventPark.notify_one();
+}
+
+// ------------------------------------------------------------------
+//
+// @details Returns the worker running on the calling thread, or nullptr
+// if the caller isn't a worker.
+//
+// ------------------------------------------------------------------
+WorkerThread* WorkerThread::current()
+{
+	return currentWorker;
+}
+
+// ------------------------------------------------------------------
+//
+// @details Looks for the next task to run.  After any high priority task,
+// the most recent task from our own deque is preferred, as its data is
+// most likely still in the cache.
+//
+// ------------------------------------------------------------------
+boost::optional<Tasks::Task*> WorkerThread::findTask()
+{
+	auto task = m_pool.takeUrgent(m_index, m_random);
+	if (task == boost::none)
+	{
+		task = findOwnTask();
+	}
+	if (task == boost::none)
+	{
+		task = stealTask();
+	}
+
+	return task;
+}
+
+// ------------------------------------------------------------------
+//
+// @details Takes a task from one of the other workers, counting it.
+//
+// ------------------------------------------------------------------
+boost::optional<Tasks::Task*> WorkerThread::stealTask()
+{
+	auto task = m_pool.steal(m_index, m_random);
+	if (task != boost::none)
+	{
+		m_statsStolen++;
+	}
+
+	return task;
+}
+
+// ------------------------------------------------------------------
+//
+// @details Looks for a task that was given to this worker, without
+// trying any of the other workers.
+//
+// ------------------------------------------------------------------
+boost::optional<Tasks::Task*> WorkerThread::findOwnTask()
+{
+	auto task = m_deque.pop();
+	if (task == boost::none)
+	{
+		task = m_inbox.dequeue();
+	}
+
+	return task;
+}
+
+// ------------------------------------------------------------------
+//
+// @details Runs a job split off from a parallel for loop.  Finishing the
+// job must be the last use of it, the worker that split it off is free
+// to return as soon as it sees the count drop.
+//
+// ------------------------------------------------------------------
+void WorkerThread::runJob(ParallelForJob* job)
+{
+	auto pending = job->pending;
+
+	runRange(*job->body, job->grain, job->begin, job->end);
+
+	pending->fetch_sub(1, std::memory_order_release);
+}
+
+// ------------------------------------------------------------------
+//
+// @details Steals a job from a parallel for loop running on another
+// worker, and runs it.  Returns false if there wasn't one to be had.
+//
+// ------------------------------------------------------------------
+bool WorkerThread::helpParallelFor()
+{
+	auto job = m_pool.stealJob(m_index, m_random);
+	if (job != boost::none)
+	{
+		runStolenJob(job.get());
+	}
+
+	return job != boost::none;
+}
+
+// ------------------------------------------------------------------
+//
+// @details Runs a job stolen while this worker had no task of its own.
+// The time is counted as busy, the same as running a task.
+//
+// ------------------------------------------------------------------
+void WorkerThread::runStolenJob(ParallelForJob* job)
+{
+	auto timeStart = std::chrono::high_resolution_clock::now();
+	auto cpuStart = boost::chrono::thread_clock::now();
+
+	runJob(job);
+
+	m_statsBusyTime += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - timeStart).count();
+	m_statsCpuTime += boost::chrono::duration_cast<boost::chrono::nanoseconds>(boost::chrono::thread_clock::now() - cpuStart).count();
+}
+
+// ------------------------------------------------------------------
+//
+// @details Runs the task through to completion.  A task cancelled while
+// waiting in a queue is never started, and one cancelled while running
+// doesn't send its result.  A task that suspended itself goes back on the
+// work queue to be run again later.
+//
+// ------------------------------------------------------------------
+void WorkerThread::runTask(Tasks::Task* task)
+{
+	auto timeStart = std::chrono::high_resolution_clock::now();
+	auto cpuStart = boost::chrono::thread_clock::now();
+	m_runningTask = true;
+	m_statsStarted++;
+	m_statsWaitTime += std::chrono::duration_cast<std::chrono::nanoseconds>(timeStart - task->getTimeQueued()).count();
+
+	if (!task->isCancelled())
+	{
+		task->execute();
+	}
+	//
+	// Once back on the work queue, another worker may pick the task up at any
+	// moment, so that has to be the last use of it here.
+	if (task->isSuspended() && !task->isCancelled())
+	{
+		m_pool.resumeTask(task);
+	}
+	else
+	{
+		if (task->isCancelled())
+		{
+			task->abandon(*m_pool.getIOService());
+		}
+		else
+		{
+			task->complete(*m_pool.getIOService());
+		}
+		TaskStatusTool::instance()->removeTask(task->getId());
+		m_pool.finishTask(task);
+	}
+
+	m_runningTask = false;
+	m_statsBusyTime += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - timeStart).count();
+	m_statsCpuTime += boost::chrono::duration_cast<boost::chrono::nanoseconds>(boost::chrono::thread_clock::now() - cpuStart).count();
+}
+
+// ------------------------------------------------------------------
+//
+// @details Waits until woken.  Once on the parked list, all of the queues
+// are checked one more time, otherwise a task or job enqueued just before
+// this worker was parked could be left sitting there.
+//
+// ------------------------------------------------------------------
+void WorkerThread::park()
+{
+	m_pool.park(this);
+
+	auto task = findTask();
+	if (task != boost::none)
+	{
+		m_pool.unpark(this);
+		runTask(task.get());
+		return;
+	}
+	auto job = m_pool.stealJob(m_index, m_random);
+	if (job != boost::none)
+	{
+		m_pool.unpark(this);
+		runStolenJob(job.get());
+		return;
+	}
+
+	auto timeStart = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now().time_since_epoch()).count();
+	m_parkedSince = timeStart;
+	{
+		std::unique_lock<std::mutex> lock(m_mutexPark);
+		m_eventPark.wait(lock, [this]() { return m_signaled || m_done; });
+		m_signaled = false;
+	}
+	//
+	// The idle time is added before clearing the start time, a snapshot taken
+	// in between may count a little of it twice, but never misses any.
+	auto timeEnd = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now().time_since_epoch()).count();
+	m_statsIdleTime += static_cast<uint64_t>(timeEnd - timeStart);
+	m_parkedSince = 0;
+	//
+	// If this worker was retired while parked, the wake up was meant for an
+	// active worker, so pass it along.
+	if (!m_pool.isActive(m_index))
+	{
+		m_pool.wakeOne();
+	}
+}
+
+// ------------------------------------------------------------------
+//
+// @details Called once the pool no longer needs this worker.  Anything
+// already handed to this worker is finished first, then it waits until
+// the pool makes it active again.
+//
+// ------------------------------------------------------------------
+void WorkerThread::retire()
+{
+	auto task = m_pool.takeOwnUrgent(m_index);
+	while (task != boost::none)
+	{
+		runTask(task.get());
+		task = m_pool.takeOwnUrgent(m_index);
+	}
+	task = findOwnTask();
+	while (task != boost::none)
+	{
+		runTask(task.get());
+		task = findOwnTask();
+	}
+
+	std::unique_lock<std::mutex> lock(m_mutexPark);
+	m_eventPark.wait(lock, [this]() { return m_done || m_pool.isActive(m_index); });
+	m_signaled = false;
+}
@@ -3,11 +3,40 @@
 
 #include "ConcurrentQueue.hpp"
 #include "Shared/Tasks/Task.hpp"
+#include "WorkStealingDeque.hpp"
 
+#include <array>
+#include <atomic>
 #include <condition_variable>
+#include <cstddef>
+#include <functional>
 #include <memory>
 #include <mutex>
+#include <random>
 #include <thread>
+#include <vector>
+
+class ThreadPool;
+
+//
+// The body of a parallel for loop, called with a [first, last) range of indices
+using ParallelForBody = std::function<void (std::size_t, std::size_t)>;
+
+// -----------------------------------------------------------------
+//
+// @details A piece of a parallel for loop, split off so that another
+// worker can steal it.  Jobs live on the stack of the worker that split
+// them off, which waits for all of them to finish before returning.
+//
+// -----------------------------------------------------------------
+struct ParallelForJob
+{
+	const ParallelForBody* body;
+	std::size_t grain;
+	std::size_t begin;
+	std::size_t end;
+	std::atomic<uint32_t>* pending;		// Jobs split off alongside this one that haven't finished
+};
 
 // -----------------------------------------------------------------
 //
@@ -16,23 +45,109 @@
 // how to effeciently wait on a work queue, then, as tasks become
 // available, it grabs the next one and works on it.
 //
+// Each worker looks for work in its own deque first, then its inbox, and
+// finally tries to steal from the other workers in the pool.  The deque
+// is only pushed to by the worker itself; tasks from other threads arrive
+// through the inbox.
+//
+// A worker the pool no longer needs is retired: it finishes whatever has
+// already been handed to it, then waits until the pool needs it again.
+//
+// A worker may be placed on a node, and pinned to some of its cores, before
+// it is started.  The thread pins itself as soon as it starts running.
+//
+// A task may run a parallel for loop.  The worker running it splits the
+// range in half, again and again, keeping one half and pushing the other
+// onto a separate deque of jobs for idle workers to steal.  Workers without
+// tasks of their own steal these jobs before stealing whole tasks, which
+// helps finish tasks already running.
+//
+// High priority tasks come ahead of all of that.  Each worker has a second
+// deque and inbox just for them, taken from, and stolen from, the same way
+// as the others, but before any of them.  A task that suspends itself to
+// make way for them is put back on the worker's own deque rather than
+// completed.
+//
 // -----------------------------------------------------------------
 class WorkerThread
 {
 public:
-	WorkerThread(ConcurrentQueue<std::shared_ptr<Tasks::Task>>& workQueue, std::condition_variable& eventWorkQueue, std::mutex& mutexWorkQueue);
+	//
+	// Running totals, the times are all in nanoseconds
+	struct Stats
+	{
+		uint64_t started;		// Tasks started
+		uint64_t waitTime;		// Time tasks spent queued before being started
+		uint64_t busyTime;		// Time spent running tasks
+		uint64_t cpuTime;		// CPU time used running tasks, busy time less this is time blocked
+		uint64_t idleTime;		// Time spent parked
+		uint64_t stolen;		// Tasks taken from other workers
+	};
+
+	WorkerThread(ThreadPool& pool, uint16_t index);
 
+	void place(uint16_t node, std::vector<uint16_t> cpus);
+	void start();
 	void run();
 	void terminate();
 	void join();
 
+	void push(Tasks::Task* task)		{ m_deque.push(task); }
+	void deliver(Tasks::Task* task)		{ m_inbox.enqueue(task); }
+	void pushUrgent(Tasks::Task* task)	{ m_urgent.push(task); }
+	void deliverUrgent(Tasks::Task* task)	{ m_urgentInbox.enqueue(task); }
+	boost::optional<Tasks::Task*> steal();
+	boost::optional<Tasks::Task*> stealUrgent();
+	boost::optional<Tasks::Task*> findOwnUrgent();
+	boost::optional<ParallelForJob*> stealJob()	{ return m_jobs.steal(); }
+	void runRange(const ParallelForBody& body, std::size_t grain, std::size_t begin, std::size_t end);
+	void wake();
+
+	ThreadPool& getPool()				{ return m_pool; }
+	uint16_t getNode()					{ return m_node; }
+	static WorkerThread* current();
+
+	bool isStarted()					{ return m_thread != nullptr; }
+	bool isRunningTask()				{ return m_runningTask; }
+	Stats getStats();
+
 private:
 	std::thread* m_thread;	// Have to manage the memory ourselves, do NOT delete when finished!
-	bool m_done;
+	std::atomic<bool> m_done;
+	std::atomic<bool> m_runningTask;
+
+	ThreadPool& m_pool;
+	uint16_t m_index;
+	WorkStealingDeque<Tasks::Task*> m_deque;
+	WorkStealingDeque<ParallelForJob*> m_jobs;
+	ConcurrentQueue<Tasks::Task*> m_inbox;
+	WorkStealingDeque<Tasks::Task*> m_urgent;		// High priority tasks, only pushed to by this worker
+	ConcurrentQueue<Tasks::Task*> m_urgentInbox;	// High priority tasks handed over by other threads
+	std::minstd_rand m_random;
+	uint16_t m_node;
+	std::vector<uint16_t> m_cpus;		// Cores to pin to, empty when not pinned
+
+	bool m_signaled;		// Set when woken from parking
+	std::condition_variable m_eventPark;
+	std::mutex m_mutexPark;
+
+	std::atomic<uint64_t> m_statsStarted;
+	std::atomic<uint64_t> m_statsWaitTime;
+	std::atomic<uint64_t> m_statsBusyTime;
+	std::atomic<uint64_t> m_statsCpuTime;
+	std::atomic<uint64_t> m_statsIdleTime;
+	std::atomic<uint64_t> m_statsStolen;
+	std::atomic<int64_t> m_parkedSince;		// Clock time parked at, zero when not parked
 
-	ConcurrentQueue<std::shared_ptr<Tasks::Task>>& m_workQueue;
-	std::condition_variable& m_eventWorkQueue;
-	std::mutex& m_mutexWorkQueue;
+	boost::optional<Tasks::Task*> findTask();
+	boost::optional<Tasks::Task*> findOwnTask();
+	boost::optional<Tasks::Task*> stealTask();
+	void runTask(Tasks::Task* task);
+	void runJob(ParallelForJob* job);
+	bool helpParallelFor();
+	void runStolenJob(ParallelForJob* job);
+	void park();
+	void retire();
 };
 
 #endif // _WORKERTHREAD_HPP_
@@ -4,7 +4,7 @@
 #include "AssignedTask.hpp"
 #include "ServerSet.hpp"
 #include "Shared/Tasks/Task.hpp"
-#include "Shared/Threading/ConcurrentPriorityQueue.hpp"
+#include "Shared/Threading/ConcurrentBucketQueue.hpp"
 
 #include <condition_variable>
 #include <memory>
@@ -58,7 +58,7 @@ private:
 	std::condition_variable m_eventRequest;
 	std::mutex m_mutexEventRequest;
 
-	ConcurrentPriorityQueue<std::shared_ptr<Tasks::Task>, TaskCompare> m_queueTasks;
+	ConcurrentBucketQueue<std::shared_ptr<Tasks::Task>, TaskLevel, TaskLevel::LEVELS> m_queueTasks;
 	std::condition_variable m_eventTask;
 	std::mutex m_mutexEventTask;
 
@@ -51,15 +51,18 @@ namespace Tasks
 
 // ------------------------------------------------------------------
 //
-// @details This class is used to compare tasks for priority
+// @details This class is used to find the priority level of a task, with
+// zero being the highest priority.
 //
 // ------------------------------------------------------------------
-class TaskCompare : public std::binary_function<const std::shared_ptr<const Tasks::Task>&, const std::shared_ptr<const Tasks::Task>&, bool>
+class TaskLevel
 {
 public:
-	bool operator()(const std::shared_ptr<const Tasks::Task>& lhs, const std::shared_ptr<const Tasks::Task>& rhs) const
+	static const std::size_t LEVELS = 3;
+
+	std::size_t operator()(const std::shared_ptr<const Tasks::Task>& task) const
 	{
-		return (lhs->getPriority() > rhs->getPriority());
+		return static_cast<std::size_t>(task->getPriority()) - static_cast<std::size_t>(Tasks::Priority::High);
 	}
 };
 
@@ -0,0 +1,157 @@
+#ifndef _CONCURRENTBUCKETQUEUE_HPP_
+#define _CONCURRENTBUCKETQUEUE_HPP_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <utility>
+
+#include <boost/optional.hpp>
+
+// ------------------------------------------------------------------
+//
+// @details This is a priority queue for items that come in a small, fixed
+// number of priority levels.  Each level is a FIFO of its own, so items at
+// the same level come out in the order they went in, and a bitmap records
+// which levels might have something in them.  Level 0 is the highest
+// priority.  L is a functor that returns the level of an item.
+//
+// Neither operation takes a lock.  Each level is a linked list where a
+// producer swaps its new node in as the head with a single atomic exchange,
+// and then links the previous head to it.  Any number of threads may
+// enqueue, but only one thread may dequeue; the work distributer is the
+// only consumer in this framework.  Having a single consumer is what makes
+// it safe for the consumer to free the nodes it has taken, as no other
+// thread can be reading them.
+//
+// ------------------------------------------------------------------
+template <typename T, typename L, std::size_t LEVELS>
+class ConcurrentBucketQueue
+{
+public:
+	ConcurrentBucketQueue() :
+		m_occupied(0)
+	{
+		static_assert(LEVELS <= 32, "The occupied levels bitmap only has room for 32 levels");
+	}
+
+	~ConcurrentBucketQueue()
+	{
+		for (auto& bucket : m_buckets)
+		{
+			auto node = bucket.tail;
+			while (node != nullptr)
+			{
+				auto next = node->next.load(std::memory_order_relaxed);
+				delete node;
+				node = next;
+			}
+		}
+	}
+
+	// ------------------------------------------------------------------
+	//
+	// @details Enqueues a new item onto the end of its level.  May be called
+	// from any number of threads at once.
+	//
+	// ------------------------------------------------------------------
+	void enqueue(const T& item)
+	{
+		auto level = static_cast<std::size_t>(L()(item));
+		auto& bucket = m_buckets[level];
+
+		auto node = new Node(item);
+		auto previous = bucket.head.exchange(node, std::memory_order_acq_rel);
+		previous->next.store(node, std::memory_order_release);
+
+		m_occupied.fetch_or(1u << level, std::memory_order_release);
+	}
+
+	// ------------------------------------------------------------------
+	//
+	// @details Attempts to dequeue the oldest item from the highest priority
+	// level that has one.  If something is available, it is returned,
+	// otherwise the optional is left empty.  Only one thread may call this.
+	//
+	// ------------------------------------------------------------------
+	boost::optional<T> dequeue()
+	{
+		boost::optional<T> item = boost::none;
+
+		auto occupied = m_occupied.load(std::memory_order_acquire);
+		for (std::size_t level = 0; level < LEVELS && item == boost::none; level++)
+		{
+			if ((occupied & (1u << level)) != 0)
+			{
+				item = dequeue(level);
+			}
+		}
+
+		return item;
+	}
+
+private:
+	struct Node
+	{
+		Node() : next(nullptr) {}
+		Node(const T& item) : next(nullptr), item(item) {}
+
+		std::atomic<Node*> next;
+		boost::optional<T> item;
+	};
+
+	// ------------------------------------------------------------------
+	//
+	// @details One level of the queue.  The tail is a node that has already
+	// been dequeued, or the initial empty node, so the list is never empty
+	// and producers never have to touch the tail.
+	//
+	// ------------------------------------------------------------------
+	struct Bucket
+	{
+		Bucket() :
+			tail(new Node())
+		{
+			head = tail;
+		}
+
+		std::atomic<Node*> head;	// Most recently enqueued, updated by producers
+		Node* tail;					// Only touched by the consumer
+	};
+
+	std::array<Bucket, LEVELS> m_buckets;
+	std::atomic<uint32_t> m_occupied;	// Bit for each level that may have items
+
+	// ------------------------------------------------------------------
+	//
+	// @details Takes the oldest item from one level.  If the level is found
+	// to be empty its bit is cleared, then the level is looked at once more,
+	// in case a producer added to it just before the bit was cleared.
+	//
+	// ------------------------------------------------------------------
+	boost::optional<T> dequeue(std::size_t level)
+	{
+		auto& bucket = m_buckets[level];
+
+		auto next = bucket.tail->next.load(std::memory_order_acquire);
+		if (next == nullptr)
+		{
+			m_occupied.fetch_and(~(1u << level), std::memory_order_acq_rel);
+			next = bucket.tail->next.load(std::memory_order_acquire);
+			if (next == nullptr)
+			{
+				return boost::none;
+			}
+			m_occupied.fetch_or(1u << level, std::memory_order_release);
+		}
+
+		boost::optional<T> item = boost::none;
+		std::swap(item, next->item);
+		delete bucket.tail;
+		bucket.tail = next;
+
+		return item;
+	}
+};
+
+#endif // _CONCURRENTBUCKETQUEUE_HPP_